@@ -12,6 +12,7 @@ cp ../../res/number_0.png .
 cp ../../res/number_1.png .
 cp ../../res/ui.png .
 cp ../../res/tile.png .
+cp ../../res/assets.pack .
 
 cd ..
 mkdir licenses
@@ -13,6 +13,7 @@ copy ..\..\res\number_0.png *
 copy ..\..\res\number_1.png *
 copy ..\..\res\ui.png *
 copy ..\..\res\tile.png *
+copy ..\..\res\assets.pack *
 
 cd ..
 mkdir licenses
@@ -0,0 +1,99 @@
+#include "alloc_counter.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#ifdef _MSC_VER
+  #include <malloc.h>
+#endif
+
+static std::atomic<u64> allocations = 0;
+static std::atomic<u64> bytes = 0;
+static u64 frame_start = 0;
+static u64 last_frame = 0;
+
+#ifdef ALLOC_COUNTER_ENABLED
+// relaxed, nothing is ordered by them. The nothrow forms default to these,
+// every delete is written out since the sized ones don't always forward
+static void* Allocate(size_t size, size_t alignment) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  bytes.fetch_add(size, std::memory_order_relaxed);
+  if (size == 0) size = 1;
+  void* p;
+  if (alignment == 0)
+    p = std::malloc(size);
+  else
+  #ifdef _MSC_VER
+    p = _aligned_malloc(size, alignment);
+  #else
+    // its size has to be a multiple of the alignment
+    p = std::aligned_alloc(alignment,
+                           (size + alignment - 1) / alignment * alignment);
+  #endif
+  if (!p) throw std::bad_alloc{};
+  return p;
+}
+
+static void FreeAligned(void* p) {
+  #ifdef _MSC_VER
+  _aligned_free(p);
+  #else
+  std::free(p);
+  #endif
+}
+
+void* operator new(size_t size) {
+  return Allocate(size, 0);
+}
+void* operator new[](size_t size) {
+  return Allocate(size, 0);
+}
+void* operator new(size_t size, std::align_val_t alignment) {
+  return Allocate(size, (size_t)alignment);
+}
+void* operator new[](size_t size, std::align_val_t alignment) {
+  return Allocate(size, (size_t)alignment);
+}
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+void operator delete[](void* p) noexcept {
+  std::free(p);
+}
+void operator delete(void* p, std::align_val_t) noexcept {
+  FreeAligned(p);
+}
+void operator delete[](void* p, std::align_val_t) noexcept {
+  FreeAligned(p);
+}
+void operator delete(void* p, size_t) noexcept {
+  std::free(p);
+}
+void operator delete[](void* p, size_t) noexcept {
+  std::free(p);
+}
+void operator delete(void* p, size_t, std::align_val_t) noexcept {
+  FreeAligned(p);
+}
+void operator delete[](void* p, size_t, std::align_val_t) noexcept {
+  FreeAligned(p);
+}
+#endif
+
+u64 AllocCounter::Allocations() {
+  return allocations.load(std::memory_order_relaxed);
+}
+
+u64 AllocCounter::Bytes() {
+  return bytes.load(std::memory_order_relaxed);
+}
+
+void AllocCounter::FrameMark() {
+  u64 now = Allocations();
+  last_frame = now - frame_start;
+  frame_start = now;
+}
+
+u64 AllocCounter::LastFrame() {
+  return last_frame;
+}
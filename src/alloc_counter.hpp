@@ -0,0 +1,27 @@
+#pragma once
+
+#include "fixed_size_int.hpp"
+
+// counts every operator new in the process, whichever thread. Replaces the
+// global operator new, so only in debug builds and with
+// -DINFINISWEEPER_PROFILE=ON, like the profiler. raylib and ImGui go through
+// malloc and aren't counted. Otherwise everything reads 0
+#if !defined(NDEBUG) || defined(INFINISWEEPER_PROFILE)
+  #define ALLOC_COUNTER_ENABLED
+#endif
+
+namespace AllocCounter {
+#ifdef ALLOC_COUNTER_ENABLED
+inline constexpr bool enabled = true;
+#else
+inline constexpr bool enabled = false;
+#endif
+
+// since launch
+u64 Allocations();
+u64 Bytes();
+
+// allocations between two FrameMarks, for the debug window
+void FrameMark();
+u64 LastFrame();
+};  // namespace AllocCounter
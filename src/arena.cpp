@@ -0,0 +1,57 @@
+#include "arena.hpp"
+
+Arena::Arena(size_t buffer_size)
+    : buffer(buffer_size ? new std::byte[buffer_size] : nullptr),
+      buffer_size(buffer_size) {
+  if (buffer_size)
+    monotonic.emplace(buffer.get(), buffer_size, &upstream);
+  else
+    monotonic.emplace(&upstream);
+}
+
+void Arena::Reset() {
+  if (upstream.bytes == 0) {
+    Release();
+    return;
+  }
+  // everything fit in the old buffer and the blocks, that's enough
+  size_t size = buffer_size + upstream.bytes;
+  monotonic.reset();  // gives the blocks back
+  buffer.reset(new std::byte[size]);
+  buffer_size = size;
+  monotonic.emplace(buffer.get(), buffer_size, &upstream);
+  Release();
+}
+
+void Arena::Release() {
+  monotonic->release();
+  allocations = 0;
+  bytes = 0;
+  upstream.blocks = 0;
+  upstream.bytes = 0;
+}
+
+void* Arena::do_allocate(size_t bytes, size_t alignment) {
+  allocations++;
+  this->bytes += bytes;
+  return monotonic->allocate(bytes, alignment);
+}
+
+bool Arena::do_is_equal(const memory_resource& other) const noexcept {
+  return this == &other;
+}
+
+void* Arena::Upstream::do_allocate(size_t bytes, size_t alignment) {
+  blocks++;
+  this->bytes += bytes;
+  return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void Arena::Upstream::do_deallocate(void* p, size_t bytes, size_t alignment) {
+  std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+}
+
+bool Arena::Upstream::do_is_equal(
+    const memory_resource& other) const noexcept {
+  return this == &other;
+}
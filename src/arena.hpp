@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+#include "fixed_size_int.hpp"
+
+// monotonic arena that counts what goes through it. Deallocating does nothing,
+// everything is freed at once by Release or Reset, or when it's destroyed
+class Arena : public std::pmr::memory_resource {
+ public:
+  // with a buffer, Release rewinds into it instead of giving memory back
+  explicit Arena(size_t buffer_size = 0);
+  void Release();
+  // Release for arenas emptied every frame. What spilled past the buffer
+  // since the last one is folded into a bigger buffer, so once that holds a
+  // frame's peak the arena stops touching the heap
+  void Reset();
+
+  template <typename T>
+  T* Allocate(size_t count) {
+    return (T*)allocate(count * sizeof(T), alignof(T));
+  }
+
+  // served since the last Release
+  u64 allocations = 0;
+  u64 bytes = 0;
+
+  // heap blocks behind them, since the last Release
+  u64 Blocks() const { return upstream.blocks; }
+  u64 BlockBytes() const { return upstream.bytes; }
+
+ private:
+  struct Upstream : public std::pmr::memory_resource {
+    u64 blocks = 0;
+    u64 bytes = 0;
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const memory_resource& other) const noexcept override;
+  };
+
+  std::unique_ptr<std::byte[]> buffer;
+  size_t buffer_size;
+  Upstream upstream;
+  // rebuilt when the buffer grows
+  std::optional<std::pmr::monotonic_buffer_resource> monotonic;
+
+  void* do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void*, size_t, size_t) override {}
+  bool do_is_equal(const memory_resource& other) const noexcept override;
+};
@@ -0,0 +1,110 @@
+#include "asset_pack.hpp"
+
+#ifdef __APPLE__
+  #define GL_SILENCE_DEPRECATION
+#else
+  #include <glad/gl.h>
+#endif
+#include <external/glfw/include/GLFW/glfw3.h>
+#include <rlgl.h>
+
+#include <fstream>
+
+AssetPack::AssetPack(const char* path) : path(path) {
+  auto file = std::ifstream{path, std::ios::binary};
+  Header header = {};
+  file.read((char*)&header, sizeof(header));
+  if (!file || header.magic != magic || header.version != version) return;
+
+  records.resize(header.count);
+  file.read((char*)records.data(), records.size() * sizeof(Record));
+  if (!file) records.clear();
+}
+
+const AssetPack::Record* AssetPack::Find(std::string_view name) const {
+  for (auto& record : records) {
+    if (name == record.name) return &record;
+  }
+  return nullptr;
+}
+
+AssetPack::Blob AssetPack::Read(std::string_view name) const {
+  Blob blob;
+  auto* record = Find(name);
+  if (!record) return blob;
+
+  auto file = std::ifstream{path, std::ios::binary};
+  blob.data.resize(record->bytes);
+  file.seekg(record->offset);
+  file.read(blob.data.data(), blob.data.size());
+  if (file) blob.record = record;
+  return blob;
+}
+
+bool AssetPack::Upload(const Blob& blob, rl::Texture2D& texture) {
+  auto* record = blob.record;
+  if (!record) return false;
+
+  auto* data = blob.data.data();
+  u32 id = rlLoadTexture(data,
+                         record->width,
+                         record->height,
+                         record->format,
+                         record->mipmaps);
+  if (id == 0) return false;  // no S3TC, raylib already warned
+
+  // compressed chains stop before 4x4 blocks stop fitting, without a max
+  // level GL would see an incomplete texture and sample black
+  glBindTexture(GL_TEXTURE_2D, id);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, record->mipmaps - 1);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  texture = ::Texture{id,
+                      (int)record->width,
+                      (int)record->height,
+                      (int)record->mipmaps,
+                      (int)record->format};
+  return true;
+}
+
+u32 AssetPack::SpriteSize(std::string_view name) const {
+  auto* record = Find(name);
+  return record ? record->width / record->columns : 0;
+}
+
+PendingTexture::PendingTexture(PendingTexture&& other) {
+  *this = std::move(other);
+}
+
+PendingTexture& PendingTexture::operator=(PendingTexture&& other) {
+  std::swap(name, other.name);
+  std::swap(blob, other.blob);
+  std::swap(image, other.image);
+  return *this;
+}
+
+PendingTexture::~PendingTexture() {
+  if (image.data) UnloadImage(image);
+}
+
+PendingTexture PendingTexture::Decode(const AssetPack& pack,
+                                      std::string name) {
+  PendingTexture texture;
+  texture.blob = pack.Read(name);
+  if (!texture.blob.record)
+    texture.image = LoadImage(("res/" + name + ".png").c_str());
+  texture.name = std::move(name);
+  return texture;
+}
+
+void PendingTexture::Upload(rl::Texture2D& texture) {
+  if (AssetPack::Upload(blob, texture)) return;
+  // the pack had it but the GPU can't take the format, decode it after all
+  if (!image.data) image = LoadImage(("res/" + name + ".png").c_str());
+  texture = rl::Texture2D{image};
+  texture.GenMipmaps();
+}
+
+u32 PendingTexture::SpriteSize() const {
+  return blob.record ? blob.record->width / blob.record->columns : 0;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "fixed_size_int.hpp"
+#include "rl.hpp"
+
+// res/assets.pack, written offline by the asset_packer target
+// (tools/asset_packer.cpp). Every texture's mip chain is baked ahead of time,
+// raw or block compressed, so startup uploads it as is instead of decoding
+// pngs and generating mips on the GPU
+class AssetPack {
+ public:
+  static constexpr u32 magic = 0x50415349;  // "ISAP"
+  static constexpr u32 version = 1;
+
+  struct Header {
+    u32 magic;
+    u32 version;
+    u32 count;
+    u32 padding;
+  };
+  // one texture, mip levels back to back, largest first
+  struct Record {
+    char name[16];  // the png's, without res/ and .png
+    u32 width;
+    u32 height;
+    u32 mipmaps;
+    u32 format;  // a raylib PixelFormat
+    // the sprite table, square sprites of width / columns, row by row
+    u32 columns;
+    u32 padding;
+    u64 offset;
+    u64 bytes;
+  };
+
+  // a mip chain read from the pack, record is null when it wasn't there
+  struct Blob {
+    const Record* record = nullptr;
+    std::vector<char> data;
+  };
+
+  // only the header and records are read, nothing when the pack is missing
+  // or from another version
+  explicit AssetPack(const char* path);
+  inline bool Loaded() const { return !records.empty(); };
+
+  // the file half of Load, safe on any thread
+  Blob Read(std::string_view name) const;
+  // the GL half, uploads the chain as it is. false when the blob is empty or
+  // the GPU can't take its format, texture is left alone then
+  static bool Upload(const Blob& blob, rl::Texture2D& texture);
+  inline bool Load(std::string_view name, rl::Texture2D& texture) const {
+    return Upload(Read(name), texture);
+  };
+  // side of name's sprites in pixels, 0 when it isn't in the pack
+  u32 SpriteSize(std::string_view name) const;
+
+ private:
+  const Record* Find(std::string_view name) const;
+
+  std::string path;
+  std::vector<Record> records;
+};
+
+// a texture decoded off the main thread, waiting for the GL context
+class PendingTexture {
+ public:
+  PendingTexture() = default;
+  PendingTexture(PendingTexture&& other);
+  PendingTexture& operator=(PendingTexture&& other);
+  ~PendingTexture();
+
+  // any thread. From the pack, or res/<name>.png when it isn't in there
+  static PendingTexture Decode(const AssetPack& pack, std::string name);
+
+  // main thread. Mips are generated on the GPU for a png, throws like
+  // rl::Texture2D when it couldn't be decoded
+  void Upload(rl::Texture2D& texture);
+  // from the pack's sprite table, 0 for a png
+  u32 SpriteSize() const;
+
+ private:
+  std::string name;
+  AssetPack::Blob blob;
+  ::Image image = {};
+};
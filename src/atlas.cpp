@@ -10,38 +10,40 @@
 #include <algorithm>
 #include <iostream>
 #include <string>
+#include <utility>
 
-#include "transform.hpp"
+#include "memory_report.hpp"
 
-AtlasManager::AtlasManager() {
-  tile = rl::Texture2D("res/tile.png");
-  tile.GenMipmaps();
-  tile.SetFilter(TEXTURE_FILTER_TRILINEAR);
+static void Load(PendingTexture& source, rl::Texture2D& texture) {
+  source.Upload(texture);
+  texture.SetFilter(TEXTURE_FILTER_TRILINEAR);
+}
+
+AtlasManager::AtlasManager(AtlasSources sources)
+    : loading(std::move(sources.loading)) {
+  Load(sources.tile, tile);
   glBindTexture(GL_TEXTURE_2D, tile.id);
   glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_LOD_BIAS, -0.5f);
   glBindTexture(GL_TEXTURE_2D, 0);
 
   for (u32 i = 0; i < 2; i++) {
-    number[i] = rl::Texture2D("res/number_" + std::to_string(i) + ".png");
-    number[i].GenMipmaps();
-    number[i].SetFilter(TEXTURE_FILTER_TRILINEAR);
+    Load(sources.number[i], number[i]);
 
     glBindTexture(GL_TEXTURE_2D, number[i].id);
     glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_LOD_BIAS, -0.5f);
     glBindTexture(GL_TEXTURE_2D, 0);
   }
 
-  tile_resolution = tile.GetWidth() / tile_x_max;
+  // the pack's sprite table when it has one
+  tile_resolution = sources.tile.SpriteSize();
+  if (!tile_resolution) tile_resolution = tile.GetWidth() / tile_x_max;
 
-  ui = rl::Texture2D("res/ui.png");
-  ui.GenMipmaps();
-  ui.SetFilter(TEXTURE_FILTER_TRILINEAR);
+  Load(sources.ui, ui);
 
-  ui_resolution = ui.GetWidth() / ui_x_max;
+  ui_resolution = sources.ui.SpriteSize();
+  if (!ui_resolution) ui_resolution = ui.GetWidth() / ui_x_max;
 
-  logo = rl::Texture2D("res/logo.png");
-  logo.GenMipmaps();
-  logo.SetFilter(TEXTURE_FILTER_TRILINEAR);
+  Load(sources.logo, logo);
 }
 
 void AtlasManager::Draw(u32 mine_num, rl::Rect rect) {
@@ -58,25 +60,27 @@ void AtlasManager::Draw(Tile type, rl::Rect rect) {
   tile.Draw(texture_rect, rect);
 }
 
-void AtlasManager::DrawUI(char character,
-                          rl::Rect screen_rect,
-                          rl::Color tint) {
+void AtlasManager::DrawUI(char character, rl::Rect rect, rl::Color tint) {
   rl::Rect texture_rect = RectFromChar(character, ui_x_max, ui_resolution);
-  auto rect = CoordTransform::ScreenToPixel(screen_rect);
   ui.Draw(texture_rect, rect, rl::Vector2{0, 0}, 0, tint);
 }
 
-void AtlasManager::DrawUI(UI index, rl::Rect screen_rect, rl::Color tint) {
+void AtlasManager::DrawUI(UI index, rl::Rect rect, rl::Color tint) {
   rl::Rect texture_rect = RectFromIndex((u32)index, ui_x_max, ui_resolution);
-  auto rect = CoordTransform::ScreenToPixel(screen_rect);
   ui.Draw(texture_rect, rect, rl::Vector2{0, 0}, 0, tint);
 }
 
-void AtlasManager::DrawLogo(rl::Rect screen_rect) {
-  auto rect = CoordTransform::ScreenToPixel(screen_rect);
+void AtlasManager::DrawLogo(rl::Rect rect) {
   logo.Draw(rl::Rect(0, 0, logo.width, logo.height), rect);
 }
 
+u64 AtlasManager::MemoryBytes() const {
+  u64 bytes = 0;
+  for (auto* texture : {&number[0], &number[1], &tile, &ui, &logo, &loading})
+    bytes += MemoryReport::TextureBytes(*texture);
+  return bytes;
+}
+
 rl::Rect AtlasManager::RectFromIndex(u32 index, u32 x_max, u32 res) {
   u32 x = index % x_max;
   u32 y = index / x_max;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "asset_pack.hpp"
 #include "fixed_size_int.hpp"
 #include "rl.hpp"
 
@@ -39,14 +40,29 @@ enum class UI {
   close,
 };
 
+// every texture the atlas draws with, decoded but not uploaded yet
+struct AtlasSources {
+  PendingTexture tile;
+  PendingTexture number[2];
+  PendingTexture ui;
+  PendingTexture logo;
+  // already uploaded, the loading screen shows it before the rest is decoded.
+  // Kept with the atlas so the memory report sees everything resident
+  rl::Texture2D loading;
+};
+
 class AtlasManager {
  public:
-  AtlasManager();
+  // uploads, main thread
+  explicit AtlasManager(AtlasSources sources);
   void Draw(u32 mine_num, rl::Rect rect);
   void Draw(Tile type, rl::Rect rect);
-  void DrawUI(char character, rl::Rect screen_rect, rl::Color tint);
-  void DrawUI(UI index, rl::Rect screen_rect, rl::Color tint);
-  void DrawLogo(rl::Rect screen_rect);
+  // everything in canvas pixels, DrawList converts the UI from the screen
+  void DrawUI(char character, rl::Rect rect, rl::Color tint);
+  void DrawUI(UI index, rl::Rect rect, rl::Color tint);
+  void DrawLogo(rl::Rect rect);
+  // every texture, mip chains included
+  u64 MemoryBytes() const;
 
  private:
   rl::Rect RectFromIndex(u32 index, u32 x_max, u32 res);
@@ -55,6 +71,7 @@ class AtlasManager {
   rl::Texture2D tile;
   rl::Texture2D ui;
   rl::Texture2D logo;
+  rl::Texture2D loading;
   const u32 number_x_max = 4;
   const u32 tile_x_max = 4;
   const u32 ui_x_max = 8;
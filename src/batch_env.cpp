@@ -0,0 +1,248 @@
+#include "batch_env.hpp"
+
+#include <toml.h>
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+#include "pack.hpp"
+#include "serializer.hpp"
+
+BatchEnv::BatchEnv(u32 games, u32 threads) {
+  for (u32 i = 0; i < games; i++) {
+    this->games.push_back(std::make_unique<Game>());
+  }
+  results.resize(games);
+  planes.resize(games);
+
+  if (threads == 0) threads = std::thread::hardware_concurrency();
+  slices = std::clamp(threads, 1u, std::max(games, 1u));
+  for (u32 i = 1; i < slices; i++) {
+    workers.emplace_back(&BatchEnv::Work, this, i);
+  }
+}
+
+BatchEnv::~BatchEnv() {
+  {
+    std::lock_guard lock(mutex);
+    quit = true;
+  }
+  wake.notify_all();
+  for (auto& worker : workers) worker.join();
+}
+
+const std::string& BatchEnv::Text(const std::string& name) {
+  for (auto& [cached, text] : texts) {
+    if (cached == name) return text;
+  }
+
+  std::string_view pack;
+  u32 number;
+  std::string text;
+  if (Pack::Split(name, pack, number)) {
+    auto level = Pack::ReadLevel(name);
+    if (!level) throw std::runtime_error{"not in its pack"};
+    text = std::move(level.value());
+  } else {
+    // written out alone, Parse takes the first table in the text as the level
+    auto levels = toml::parse_file("levels.toml");
+    auto* table = levels[name].as_table();
+    if (!table) throw std::runtime_error{"no level " + name};
+    std::ostringstream stream;
+    stream << toml::table{{name, *table}};
+    text = stream.str();
+  }
+  return texts.emplace_back(name, std::move(text)).second;
+}
+
+void BatchEnv::Reset(const std::string& name, std::span<const u64> seeds) {
+  // a short span would leave the rest of the games in whatever state the last
+  // run left them, and a replay couldn't tell
+  if (seeds.size() != games.size())
+    throw std::runtime_error{"one seed per game"};
+  auto& text = Text(name);
+  Run([&](u32 begin, u32 end) {
+    for (u32 i = begin; i < end; i++) {
+      ResetGame(*games[i], name, text, seeds[i]);
+    }
+  });
+}
+
+void BatchEnv::ResetFinished(const std::string& name, u64 seed) {
+  auto& text = Text(name);
+  Run([&](u32 begin, u32 end) {
+    for (u32 i = begin; i < end; i++) {
+      if (games[i]->level.state != State::gaming)
+        ResetGame(*games[i], name, text, seed + i);
+    }
+  });
+}
+
+void BatchEnv::ResetGame(Game& game,
+                         const std::string& name,
+                         const std::string& text,
+                         u64 seed) {
+  auto& level = game.level;
+  Serializer::Parse(name, level, 0, seed, text);
+  game.covered_safe = 0;
+  for (auto& board : level.boards) {
+    board.ForEachCell([&](i32, i32, Cell& cell) {
+      if (cell.covered && !cell.mine) game.covered_safe++;
+    });
+  }
+}
+
+std::span<const BatchEnv::Result> BatchEnv::Step(
+    std::span<const Move> moves) {
+  Run([&](u32 begin, u32 end) {
+    for (u32 i = begin; i < std::min<u64>(end, moves.size()); i++) {
+      StepGame(*games[i], moves[i], results[i]);
+    }
+  });
+  return results;
+}
+
+void BatchEnv::StepGame(Game& game, Move move, Result& result) {
+  auto& level = game.level;
+  result = {level.state};
+  if (level.state != State::gaming) return;
+
+  // the same moves HandleMouseInput would let through
+  auto& id = move.id;
+  if (id.board_index >= level.boards.size() || !level.Get(id)) {
+    result.invalid = true;
+    return;
+  }
+  bool covered = level.Get(id)->covered;
+  if ((move.type == MoveType::mark && !covered) ||
+      (move.type == MoveType::chord && covered)) {
+    result.invalid = true;
+    return;
+  }
+
+  level.Apply(move);
+
+  // Tick's win check walks every cell, the delta says what changed
+  if (!level.history.empty()) {
+    for (auto& run : level.history.back().uncovered) {
+      auto& board = level.boards[run.board_index];
+      for (u64 i = run.start; i < run.start + run.length; i++) {
+        if (!board.Get(i % board.width, i / board.width)->mine)
+          game.covered_safe--;
+      }
+      result.uncovered += run.length;
+    }
+  }
+  // nothing here undoes, don't let the history and journal grow
+  level.history.clear();
+  level.history_at = 0;
+  level.moves.clear();
+
+  if (level.state == State::gaming && game.covered_safe == 0 &&
+      !level.endless) {
+    level.mine_left = 0;
+    level.state = State::won;
+  }
+  result.state = level.state;
+}
+
+std::span<const BatchEnv::Planes> BatchEnv::Observe() {
+  Run([&](u32 begin, u32 end) {
+    for (u32 i = begin; i < end; i++) ObserveGame(*games[i], planes[i]);
+  });
+  return planes;
+}
+
+void BatchEnv::ObserveGame(Game& game, Planes& planes) {
+  auto& level = game.level;
+  // the layout only changes on a reset, but working it out is cheap and the
+  // vectors keep their capacity
+  planes.boards.clear();
+  // a board can pass 2^32 cells, so the sizes are all u64
+  u64 offset = 0;
+  for (auto& board : level.boards) {
+    u64 stride = (u64{board.width} * board.height + 63) / 64;
+    planes.boards.push_back({board.width, board.height, offset, stride});
+    offset += stride * Planes::count;
+  }
+  planes.words.assign(offset, 0);
+
+  for (u32 b = 0; b < level.boards.size(); b++) {
+    auto& layout = planes.boards[b];
+    u64* words = &planes.words[layout.offset];
+    level.boards[b].ForEachCell([&](i32 x, i32 y, Cell& cell) {
+      u64 index = u64(y) * layout.width + x;
+      u64 bit = 1ull << (index % 64);
+      u64* word = words + index / 64;
+      auto set = [&](u64 plane) { word[plane * layout.stride] |= bit; };
+
+      set(Planes::exists);
+      if (cell.covered) {
+        set(Planes::covered);
+        if (cell.flagged) set(Planes::flagged);
+        if (cell.question_mark) set(Planes::question_mark);
+        return;  // a covered cell's number isn't the player's to see
+      }
+      if (cell.mine) {
+        set(Planes::detonated);
+        return;
+      }
+      u32 number = std::min(cell.number, 15u);
+      for (u32 i = 0; i < 4; i++) {
+        if (number >> i & 1) set(Planes::number + i);
+      }
+    });
+  }
+}
+
+void BatchEnv::Run(std::function<void(u32, u32)> f) {
+  if (slices == 1) {
+    f(0, games.size());
+    return;
+  }
+
+  {
+    std::lock_guard lock(mutex);
+    job = std::move(f);
+    generation++;
+    running = slices - 1;
+    error = nullptr;
+  }
+  wake.notify_all();
+
+  std::exception_ptr mine;
+  try {
+    job(0, games.size() / slices);
+  } catch (...) {
+    mine = std::current_exception();
+  }
+
+  std::unique_lock lock(mutex);
+  finished.wait(lock, [&] { return running == 0; });
+  if (mine) std::rethrow_exception(mine);
+  if (error) std::rethrow_exception(error);
+}
+
+void BatchEnv::Work(u32 slice) {
+  u64 seen = 0;
+  while (true) {
+    std::unique_lock lock(mutex);
+    wake.wait(lock, [&] { return quit || generation != seen; });
+    if (quit) return;
+    seen = generation;
+    lock.unlock();
+
+    u64 size = games.size();
+    try {
+      job(size * slice / slices, size * (slice + 1) / slices);
+    } catch (...) {
+      lock.lock();
+      if (!error) error = std::current_exception();
+      lock.unlock();
+    }
+
+    lock.lock();
+    if (--running == 0) finished.notify_one();
+  }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fixed_size_int.hpp"
+#include "logic.hpp"
+
+// many independent games stepped together on a thread pool, for bots and
+// analytics. Only Serializer::Parse and Level::Apply run, neither touches the
+// camera, input or any other global, so there's no window and no limit of one
+// game per process. Not thread safe itself, call it from one thread
+class BatchEnv {
+ public:
+  // what a step did to one game
+  struct Result {
+    State state = State::gaming;
+    u32 uncovered = 0;     // cells the move opened
+    bool invalid = false;  // off the boards or on a void cell, not applied
+  };
+
+  // the player's view of one game, one bit per cell. Each board's planes are
+  // its cells row-major, padded to whole words, one plane after another
+  struct Planes {
+    enum Plane : u32 {
+      exists,  // not void
+      covered,
+      flagged,
+      question_mark,
+      detonated,  // an opened mine
+      number,     // 4 planes, the low bit first, capped at 15
+      count = number + 4,
+    };
+    struct Board {
+      u32 width;
+      u32 height;
+      u64 offset;  // into words, of the exists plane
+      u64 stride;  // words per plane
+    };
+    vector<Board> boards;
+    vector<u64> words;
+
+    inline const u64* Get(u32 board, Plane plane) const {
+      return &words[boards[board].offset + u64{plane} * boards[board].stride];
+    };
+  };
+
+  // threads = 0 uses every core. The calling thread works too
+  BatchEnv(u32 games, u32 threads = 0);
+  ~BatchEnv();
+
+  inline u32 Size() const { return games.size(); };
+
+  // every game from name (a levels.toml table or a pack level), game i is
+  // seeded with seeds[i], one seed per game. Throws when the sizes differ or
+  // what Parse threw
+  void Reset(const std::string& name, std::span<const u64> seeds);
+  // only the games that are over, game i is seeded with seed + i
+  void ResetFinished(const std::string& name, u64 seed);
+
+  // moves[i] goes to game i, games that are over skip theirs
+  std::span<const Result> Step(std::span<const Move> moves);
+
+  // every game's planes, valid until the next Observe
+  std::span<const Planes> Observe();
+
+ private:
+  struct Game {
+    Level level;
+    u64 covered_safe = 0;  // none left is a win
+  };
+
+  // the level's table on its own, levels.toml is parsed once per name
+  const std::string& Text(const std::string& name);
+  void ResetGame(Game& game,
+                 const std::string& name,
+                 const std::string& text,
+                 u64 seed);
+  void StepGame(Game& game, Move move, Result& result);
+  void ObserveGame(Game& game, Planes& planes);
+
+  // f(begin, end) over every game, split between the pool and this thread.
+  // Rethrows the first exception a slice threw
+  void Run(std::function<void(u32, u32)> f);
+  void Work(u32 slice);
+
+  vector<std::unique_ptr<Game>> games;  // apart, workers don't share lines
+  vector<Result> results;
+  vector<Planes> planes;
+  vector<pair<std::string, std::string>> texts;
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable finished;
+  std::function<void(u32, u32)> job;
+  u64 generation = 0;
+  u32 running = 0;
+  bool quit = false;
+  std::exception_ptr error;
+  u32 slices = 1;               // games are split this many ways
+  vector<std::thread> workers;  // slice i, slice 0 is the caller's
+};
@@ -0,0 +1,446 @@
+#include "bench.hpp"
+
+#include <toml.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "alloc_counter.hpp"
+#include "batch_env.hpp"
+#include "logic.hpp"
+#include "draw_list.hpp"
+#include "memory_report.hpp"
+#include "serializer.hpp"
+#include "simulation.hpp"
+#include "ssaa_window.hpp"
+#include "stress.hpp"
+#include "transform.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+static double MsSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+int Bench::Run(int argc, char** argv) {
+  std::string name = argc > 0 ? argv[0] : "";
+
+  // what the level logic reads of the window, as if it was 1080p
+  canvas_size = rl::Vector2{1920, 1080};
+  window_size = canvas_size;
+  inverse_aspect_ratio = canvas_size.y / canvas_size.x;
+  ssaa_scale = 1.0f;
+
+  if (name == "zoom") {
+    Level level;
+    u32 levels = argc > 1 ? std::atoi(argv[1]) : 50;
+    u32 frames = argc > 2 ? std::atoi(argv[2]) : 60;
+    Zoom(level, levels, frames);
+    return 0;
+  }
+
+  if (name == "memory") {
+    Memory(std::vector<std::string>(argv + 1, argv + argc));
+    return 0;
+  }
+
+  if (name == "scale") {
+    return Scale(std::vector<std::string>(argv + 1, argv + argc)) ? 0 : 1;
+  }
+
+  if (name == "render") {
+    return Render(std::vector<std::string>(argv + 1, argv + argc)) ? 0 : 1;
+  }
+
+  if (name == "capture") {
+    return Capture(std::vector<std::string>(argv + 1, argv + argc)) ? 0 : 1;
+  }
+
+  if (name == "steady") {
+    return Steady(std::vector<std::string>(argv + 1, argv + argc)) ? 0 : 1;
+  }
+
+  if (name == "env") {
+    return Env(std::vector<std::string>(argv + 1, argv + argc)) ? 0 : 1;
+  }
+
+  // not a benchmark, prints the level Scale would make from these
+  if (name == "generate") {
+    StressParams params;
+    for (int i = 1; i < argc; i++) {
+      if (!Stress::Set(params, argv[i])) {
+        fprintf(stderr, "unknown parameter %s\n", argv[i]);
+        return 1;
+      }
+    }
+    printf("%s", Stress::Generate(params, "1").c_str());
+    return 0;
+  }
+
+  fprintf(stderr,
+          "benchmarks:\n"
+          "  zoom [levels = 50] [frames = 60]\n"
+          "  memory [level...]\n"
+          "  scale [only=<param>] [frames=30] [<param>=<value>...]\n"
+          "  generate [<param>=<value>...]\n"
+          "  render [level...] [frames=240] [width=1280] [height=720] "
+          "[scale=2] [gpu]\n"
+          "  capture [level=mainmenu] [x=] [y=] [zoom=] [dive=1] [frames=1] "
+          "[settle=8] [width=1280] [height=720] [scale=1] [out=capture] "
+          "[raw] [gpu]\n"
+          "  steady [level...] [frames=240]\n"
+          "  env [level=1] [games=1024] [threads=0] [steps=1000]\n"
+          "params: boards size fanout depth clones cycles density\n");
+  return 1;
+}
+
+void Bench::Zoom(Level& level, u32 levels, u32 frames) {
+  Serializer::Load("mainmenu", level);
+  auto& board = level.boards[level.root_board];
+  auto& portal = level.portals.front();
+
+  // the main menu holds itself in its portal. Zooming at the fixed point of
+  // that, x -> portal.x + x / scale, goes exactly one level down per scale
+  float scale = (float)board.width / portal.width;
+  auto center = rl::Vector2{portal.x * scale / (scale - 1),
+                            portal.y * scale / (scale - 1)};
+  float factor = std::pow(scale, (float)levels / frames);
+
+  printf("zoom: %u levels in %u frames, x%.2f per frame\n",
+         levels,
+         frames,
+         factor);
+
+  for (bool zoom_in : {true, false}) {
+    camera_coord = center;
+    if (zoom_in) camera_zoom = 1.0f / board.width;
+    CoordTransform::UpdateCameraWorldRect();
+    level.ChangeRootBoard();
+
+    u32 hops = 0;
+    u32 max_hops = 0;
+    float max_view = 0;  // screen width in root board widths, 1/scale to 1
+    double total_ms = 0;
+    double max_ms = 0;
+    u32 max_drawn = 0;   // board instances drawn cell by cell
+    u32 max_copied = 0;  // and ones portal feedback covers
+    for (u32 i = 0; i < frames; i++) {
+      auto start = Clock::now();
+      camera_zoom = zoom_in ? camera_zoom * factor : camera_zoom / factor;
+      CoordTransform::UpdateCameraWorldRect();
+      u32 frame_hops = level.ChangeRootBoard();
+      double ms =
+          std::chrono::duration<double, std::milli>(Clock::now() - start)
+              .count();
+
+      hops += frame_hops;
+      max_hops = std::max(max_hops, frame_hops);
+      // a root lagging behind shows up as the view shrinking away from it
+      float view = 1.0f / (camera_zoom * board.width);
+      max_view = std::max(max_view, zoom_in ? 1.0f / view : view);
+      total_ms += ms;
+      max_ms = std::max(max_ms, ms);
+
+      u32 instances = level.board_rect_cache.size();
+      u32 copied = 0;
+      for (auto& info : level.board_rect_cache)
+        if (info.feedback) copied++;
+      max_drawn = std::max(max_drawn, instances - copied);
+      max_copied = std::max(max_copied, copied);
+    }
+
+    printf("  %s: %u hops, at most %u a frame, root off by x%.2f at worst, "
+           "%.3fms avg %.3fms max a frame, at most %u boards drawn and %u "
+           "copied\n",
+           zoom_in ? "in " : "out",
+           hops,
+           max_hops,
+           max_view,
+           total_ms / frames,
+           max_ms,
+           max_drawn,
+           max_copied);
+  }
+}
+
+void Bench::Memory(std::vector<std::string> names) {
+  if (names.empty()) {
+    auto levels = toml::parse_file("levels.toml");
+    for (auto& [key, node] : levels) {
+      if (node.is_table()) names.push_back(std::string{key.str()});
+    }
+  }
+
+  LevelMemory memory;
+  printf("[");
+  for (u32 i = 0; i < names.size(); i++) {
+    // fresh every time, so nothing is left over from the previous one
+    Level level;
+    Serializer::Load(names[i], level);
+    level.MeasureMemory(memory);
+    printf(i ? ",\n" : "\n");
+    MemoryReport::WriteJson(stdout, memory, nullptr);
+  }
+  printf("\n]\n");
+}
+
+BenchSample Bench::Measure(Level& level, u32 frames) {
+  BenchSample sample;
+  sample.boards = level.boards.size();
+
+  auto start = Clock::now();
+  for (u32 b = 0; b < level.boards.size(); b++) {
+    level.boards[b].ForEachCell([&](i32 x, i32 y, Cell&) {
+      level.Neighbors({x, y, b});
+      sample.cells++;
+    });
+    // route scratch, the game drops it every tick
+    level.frame_arena->Reset();
+  }
+  sample.neighbors_ms = MsSince(start);
+
+  DrawList list;
+  for (u32 i = 0; i < frames; i++) {
+    level.frame_arena->Reset();
+    start = Clock::now();
+    level.UpdateBoardRectCache();
+    sample.rect_cache_ms += MsSince(start);
+
+    list.Clear();
+    start = Clock::now();
+    level.Draw(list);
+    sample.draw_ms += MsSince(start);
+  }
+  sample.rect_cache_ms /= std::max(frames, 1u);
+  sample.draw_ms /= std::max(frames, 1u);
+  sample.rect_cache_entries = level.board_rect_cache.size();
+  sample.draw_commands = list.Size();
+
+  LevelMemory memory;
+  level.MeasureMemory(memory);
+  sample.memory_bytes = memory.Total();
+  return sample;
+}
+
+bool Bench::Scale(std::vector<std::string> args) {
+  StressParams base;
+  u32 frames = 30;
+  std::string only;
+  for (auto& arg : args) {
+    if (arg.starts_with("frames=")) {
+      frames = std::atoi(arg.c_str() + 7);
+    } else if (arg.starts_with("only=")) {
+      only = arg.substr(5);
+    } else if (!Stress::Set(base, arg)) {
+      fprintf(stderr, "unknown parameter %s\n", arg.c_str());
+      return false;
+    }
+  }
+
+  // about doubling every step, far enough to show where it stops being linear
+  static const std::pair<const char*, std::vector<const char*>> sweeps[] = {
+      {"boards", {"4", "8", "16", "32", "64", "128", "256", "512"}},
+      {"size", {"8", "16", "32", "64", "128", "256", "512"}},
+      {"fanout", {"1", "2", "4", "8", "16"}},
+      {"depth", {"1", "2", "4", "8", "16"}},
+      {"clones", {"0", "1", "2"}},
+      {"cycles", {"0", "1", "4", "16"}},
+      {"density", {"0.05", "0.15", "0.3", "0.6"}},
+  };
+
+  printf("param,value,boards,cells,load_ms,neighbors_ms,rect_cache_ms,"
+         "draw_ms,rect_cache_entries,draw_commands,memory_bytes\n");
+  for (auto& [param, values] : sweeps) {
+    if (!only.empty() && only != param) continue;
+    for (auto value : values) {
+      auto params = base;
+      Stress::Set(params, std::string{param} + "=" + value);
+      auto text = Stress::Generate(params, "stress");
+
+      // same seed every run, so runs compare
+      Level level;
+      auto start = Clock::now();
+      Serializer::Parse("stress", level, 0, 1, text);
+      Serializer::Activate(level);
+      double load_ms = MsSince(start);
+
+      auto sample = Measure(level, frames);
+      sample.load_ms = load_ms;
+      printf("%s,%s,%u,%u,%.3f,%.3f,%.4f,%.4f,%u,%u,%llu\n",
+             param,
+             value,
+             sample.boards,
+             sample.cells,
+             sample.load_ms,
+             sample.neighbors_ms,
+             sample.rect_cache_ms,
+             sample.draw_ms,
+             sample.rect_cache_entries,
+             sample.draw_commands,
+             (unsigned long long)sample.memory_bytes);
+      fflush(stdout);
+    }
+  }
+  return true;
+}
+
+bool Bench::Env(std::vector<std::string> args) {
+  std::string name = "1";
+  u32 games = 1024;
+  u32 threads = 0;
+  u32 steps = 1000;
+  for (auto& arg : args) {
+    auto split = arg.find('=');
+    auto key = arg.substr(0, split);
+    auto value = split == std::string::npos ? "" : arg.substr(split + 1);
+    if (key == "level") {
+      name = value;
+    } else if (key == "games") {
+      games = std::atoi(value.c_str());
+    } else if (key == "threads") {
+      threads = std::atoi(value.c_str());
+    } else if (key == "steps") {
+      steps = std::atoi(value.c_str());
+    } else {
+      fprintf(stderr, "unknown parameter %s\n", arg.c_str());
+      return false;
+    }
+  }
+
+  BatchEnv env{games, threads};
+  std::vector<u64> seeds(games);
+  for (u32 i = 0; i < games; i++) seeds[i] = i + 1;
+  env.Reset(name, seeds);
+
+  // a bot that can't think: opens a random covered cell it sees, sometimes
+  // flags one instead
+  Rng rng{1};
+  std::vector<Move> moves(games, Move{MoveType::open, CellID{0, 0, 0}});
+  auto pick = [&](const BatchEnv::Planes& planes, Move& move) {
+    for (int tries = 0; tries < 16; tries++) {
+      u32 board = rng.Range(0, planes.boards.size() - 1);
+      auto& layout = planes.boards[board];
+      i32 x = rng.Range(0, layout.width - 1);
+      i32 y = rng.Range(0, layout.height - 1);
+      u64 index = u64(y) * layout.width + x;
+      auto* covered = planes.Get(board, BatchEnv::Planes::covered);
+      if (!(covered[index / 64] >> (index % 64) & 1)) continue;
+      move.type = rng.Range(0, 9) == 0 ? MoveType::mark : MoveType::open;
+      move.id = CellID{x, y, board};
+      return;
+    }
+  };
+
+  double step_ms = 0;
+  double observe_ms = 0;
+  double reset_ms = 0;
+  u64 applied = 0;
+  u64 uncovered = 0;
+  u32 won = 0;
+  u32 lost = 0;
+  for (u32 i = 0; i < steps; i++) {
+    auto start = Clock::now();
+    auto observations = env.Observe();
+    observe_ms += MsSince(start);
+    for (u32 game = 0; game < games; game++) {
+      pick(observations[game], moves[game]);
+    }
+
+    start = Clock::now();
+    auto results = env.Step(moves);
+    step_ms += MsSince(start);
+    for (auto& result : results) {
+      if (!result.invalid) applied++;
+      uncovered += result.uncovered;
+      if (result.state == State::won) won++;
+      if (result.state == State::lost) lost++;
+    }
+
+    start = Clock::now();
+    env.ResetFinished(name, (u64)(i + 1) * games + 1);
+    reset_ms += MsSince(start);
+  }
+
+  printf("env: %s, %u games, %u steps\n", name.c_str(), games, steps);
+  printf("step: %.0f moves/s, %llu applied, %llu cells opened\n",
+         (double)games * steps / step_ms * 1000,
+         (unsigned long long)applied,
+         (unsigned long long)uncovered);
+  printf("observe: %.0f games/s\n", (double)games * steps / observe_ms * 1000);
+  printf("reset: %.1f ms in total, %u won, %u lost\n", reset_ms, won, lost);
+  return true;
+}
+
+bool Bench::Steady(std::vector<std::string> args) {
+  if (!AllocCounter::enabled) {
+    fprintf(stderr,
+            "allocations aren't counted in this build, use a debug one or "
+            "-DINFINISWEEPER_PROFILE=ON\n");
+    return false;
+  }
+  std::vector<std::string> levels;
+  u32 frames = 240;  // a lap of the path
+  for (auto& arg : args) {
+    if (arg.starts_with("frames="))
+      frames = std::atoi(arg.c_str() + 7);
+    else
+      levels.push_back(arg);
+  }
+  if (levels.empty()) levels = {"mainmenu", "1", "16"};
+
+  InputFrame input;
+  input.frame_time = 1.0f / 60.0f;
+  input.view = {canvas_size,
+                window_size,
+                canvas_size,
+                inverse_aspect_ratio,
+                ssaa_scale,
+                false,
+                false};
+
+  // a lap: pans with the keys one way and back, zooms in and back out, the
+  // mouse circling over the window all along. The second lap goes where the
+  // first went, nothing new should need memory
+  static const int keys[] = {KEY_D, KEY_A, KEY_LEFT_CONTROL, KEY_LEFT_SHIFT};
+  auto lap = [&](Simulation& simulation, u64* allocations) {
+    for (u32 i = 0; i < frames; i++) {
+      float t = (float)i / frames;
+      input.keys_down.reset();
+      input.keys_down[keys[(u32)(t * 4)]] = true;
+      auto previous = input.mouse_position;
+      float angle = 2.0f * PI * 3.0f * t;
+      input.mouse_position =
+          window_size / 2 +
+          rl::Vector2{std::cos(angle), std::sin(angle)} * window_size.y * 0.4f;
+      input.mouse_delta = input.mouse_position - previous;
+      input.time += input.frame_time;
+
+      u64 before = AllocCounter::Allocations();
+      simulation.Submit(input);
+      simulation.Latest();
+      if (allocations) *allocations += AllocCounter::Allocations() - before;
+    }
+  };
+
+  bool steady = true;
+  for (auto& name : levels) {
+    auto level = std::make_unique<Level>();
+    Serializer::Parse(name, *level, 0, 1);
+    Simulation simulation{input, false, std::move(level)};
+
+    u64 allocations = 0;
+    lap(simulation, nullptr);
+    lap(simulation, &allocations);
+    printf("%s: %llu allocations in %u steady frames\n",
+           name.c_str(),
+           (unsigned long long)allocations,
+           frames);
+    steady = steady && allocations == 0;
+  }
+  return steady;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "fixed_size_int.hpp"
+
+class Level;
+
+// what Measure times on one level
+struct BenchSample {
+  double load_ms = 0;        // Parse and Activate
+  double neighbors_ms = 0;   // every cell's neighbors, routes included
+  double rect_cache_ms = 0;  // UpdateBoardRectCache, a frame on average
+  double draw_ms = 0;        // Level::Draw into a DrawList, same
+  u32 boards = 0;
+  u32 cells = 0;
+  u32 rect_cache_entries = 0;
+  u32 draw_commands = 0;
+  u64 memory_bytes = 0;  // the memory report's total, neighbors built
+};
+
+// headless benchmarks, `InfiniSweeper --bench <name> [args]`. No window, the
+// results go to stdout. Run them from the folder with levels.toml in it
+namespace Bench {
+// everything after --bench, returns the exit code
+int Run(int argc, char** argv);
+
+// zooms into the main menu's self-portal through `levels` nesting levels in
+// `frames` frames, then back out, root board changes included
+void Zoom(Level& level, u32 levels, u32 frames);
+
+// a json array with the memory report of every level right after loading,
+// every level in levels.toml when names is empty
+void Memory(std::vector<std::string> names);
+
+// a freshly loaded level, camera where Serializer::Activate left it. Doesn't
+// fill in load_ms
+BenchSample Measure(Level& level, u32 frames);
+
+// generated levels, one parameter swept at a time from StressParams'
+// defaults, key=value args override those. A csv row per level, ready to plot.
+// false on an unknown argument
+bool Scale(std::vector<std::string> args);
+
+// flies a scripted camera path through each level at fixed time steps and
+// renders it for real, in a hidden window on Mesa's llvmpipe unless `gpu` is
+// given. Frame time percentiles, GL draw calls, board instances and cells per
+// path segment as csv. false on an unknown argument
+bool Render(std::vector<std::string> args);
+
+// renders one level from one camera without showing a window and reads the
+// canvas back through Readback, two frames in flight, into a png or raw RGBA8
+// file per frame. dive=<factor> zooms every frame after the first. false on
+// an unknown argument or a file that couldn't be written
+bool Capture(std::vector<std::string> args);
+
+// pans, zooms and hovers over each level through the whole simulation step,
+// one lap to warm up and one counted by AllocCounter. false when the counted
+// lap allocated, or allocations aren't counted in this build
+bool Steady(std::vector<std::string> args);
+
+// random moves in `games` games of one level at once on a BatchEnv, finished
+// games start over. Steps, observations and resets per second. false on an
+// unknown argument
+bool Env(std::vector<std::string> args);
+};  // namespace Bench
@@ -0,0 +1,117 @@
+#include "draw_list.hpp"
+
+#include "profiler.hpp"
+#include "transform.hpp"
+
+void DrawList::Clear() {
+  commands.clear();
+  sources.clear();
+}
+
+size_t DrawList::Cells() const {
+  size_t cells = 0;
+  for (auto& command : commands) {
+    if (command.op == Op::number || command.op == Op::tile) cells++;
+  }
+  return cells;
+}
+
+void DrawList::Draw(u32 mine_num, rl::Rect rect) {
+  commands.push_back({Op::number, mine_num, rect, WHITE, 0, 0});
+}
+
+void DrawList::Draw(Tile type, rl::Rect rect) {
+  commands.push_back({Op::tile, (u32)type, rect, WHITE, 0, 0});
+}
+
+void DrawList::DrawUI(char character, rl::Rect screen_rect, rl::Color tint) {
+  auto rect = CoordTransform::ScreenToPixel(screen_rect);
+  commands.push_back({Op::ui_char, (u32)character, rect, tint, 0, 0});
+}
+
+void DrawList::DrawUI(UI index, rl::Rect screen_rect, rl::Color tint) {
+  auto rect = CoordTransform::ScreenToPixel(screen_rect);
+  commands.push_back({Op::ui, (u32)index, rect, tint, 0, 0});
+}
+
+void DrawList::DrawLogo(rl::Rect screen_rect) {
+  auto rect = CoordTransform::ScreenToPixel(screen_rect);
+  commands.push_back({Op::logo, 0, rect, WHITE, 0, 0});
+}
+
+void DrawList::DrawRect(rl::Rect rect, rl::Color color) {
+  commands.push_back({Op::rect, 0, rect, color, 0, 0});
+}
+
+void DrawList::DrawRoundedLines(rl::Rect rect,
+                                float roundness,
+                                u32 segments,
+                                float thickness,
+                                rl::Color color) {
+  commands.push_back(
+      {Op::rounded_lines, segments, rect, color, roundness, thickness});
+}
+
+void DrawList::DrawRing(rl::Vector2 center,
+                        float inner_radius,
+                        float outer_radius,
+                        float start_angle,
+                        float end_angle,
+                        u32 segments,
+                        rl::Color color) {
+  auto rect = rl::Rect{center.x, center.y, inner_radius, outer_radius};
+  commands.push_back(
+      {Op::ring, segments, rect, color, start_angle, end_angle});
+}
+
+void DrawList::DrawFeedback(rl::Rect last_source,
+                            rl::Rect source,
+                            rl::Rect rect) {
+  commands.push_back({Op::feedback, (u32)sources.size(), rect, WHITE, 0, 0});
+  sources.push_back({last_source, source});
+}
+
+void DrawList::Replay(AtlasManager& atlas,
+                      const FeedbackTexture* feedback,
+                      bool own_feedback) const {
+  PROFILE_ZONE("DrawList::Replay");
+  for (auto& command : commands) {
+    auto rect = command.rect;
+    switch (command.op) {
+      case Op::number: atlas.Draw(command.index, rect); break;
+      case Op::tile: atlas.Draw((Tile)command.index, rect); break;
+      case Op::ui_char:
+        atlas.DrawUI((char)command.index, rect, command.color);
+        break;
+      case Op::ui: atlas.DrawUI((UI)command.index, rect, command.color); break;
+      case Op::logo: atlas.DrawLogo(rect); break;
+      case Op::rect: rect.Draw(command.color); break;
+      case Op::rounded_lines:
+        rect.DrawRoundedLines(
+            command.a, command.index, command.b, command.color);
+        break;
+      case Op::ring:
+        ::DrawRing(rl::Vector2{rect.x, rect.y},
+                   rect.width,
+                   rect.height,
+                   command.a,
+                   command.b,
+                   command.index,
+                   command.color);
+        break;
+      case Op::feedback: {
+        if (!feedback) break;
+        // flipped the same way SSAAWindow presents the canvas
+        auto& source = own_feedback ? sources[command.index].own
+                                    : sources[command.index].last;
+        auto flipped = rl::Rect{source.x,
+                                feedback->canvas_height - source.y -
+                                    source.height,
+                                source.width,
+                                -source.height};
+        ((rl::Texture&)feedback->texture).Draw(flipped, rect);
+        break;
+      }
+    }
+  }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vector>
+
+#include "atlas.hpp"
+#include "fixed_size_int.hpp"
+#include "rl.hpp"
+
+// last frame's canvas, kept by SSAAWindow for portal feedback
+struct FeedbackTexture {
+  ::Texture texture;
+  float canvas_height;  // rows are flipped, GL's origin is bottom left
+};
+
+// drawing recorded instead of issued, so it can be built away from the thread
+// owning the GL context and replayed there. Everything is converted to canvas
+// pixels while recording, replaying reads no globals
+class DrawList {
+ public:
+  void Clear();
+  inline size_t Size() const { return commands.size(); };
+  inline void Reserve(size_t size) { commands.reserve(size); };
+  inline bool HasFeedback() const { return !sources.empty(); };
+  // tiles and numbers, for benchmarks. Walks the list
+  size_t Cells() const;
+
+  // same as AtlasManager's, rect in pixels
+  void Draw(u32 mine_num, rl::Rect rect);
+  void Draw(Tile type, rl::Rect rect);
+  // these take screen coordinates
+  void DrawUI(char character, rl::Rect screen_rect, rl::Color tint);
+  void DrawUI(UI index, rl::Rect screen_rect, rl::Color tint);
+  void DrawLogo(rl::Rect screen_rect);
+
+  // pixels again
+  void DrawRect(rl::Rect rect, rl::Color color);
+  void DrawRoundedLines(rl::Rect rect,
+                        float roundness,
+                        u32 segments,
+                        float thickness,
+                        rl::Color color);
+  void DrawRing(rl::Vector2 center,
+                float inner_radius,
+                float outer_radius,
+                float start_angle,
+                float end_angle,
+                u32 segments,
+                rl::Color color);
+  // pixels of the previous frame into rect. The source is at last_source on
+  // a canvas some other list drew, at source on one this list drew itself
+  void DrawFeedback(rl::Rect last_source, rl::Rect source, rl::Rect rect);
+
+  // without feedback its commands are skipped. own_feedback when feedback was
+  // captured replaying this very list
+  void Replay(AtlasManager& atlas,
+              const FeedbackTexture* feedback = nullptr,
+              bool own_feedback = false) const;
+
+ private:
+  enum class Op : u8 {
+    number,
+    tile,
+    ui_char,
+    ui,
+    logo,
+    rect,
+    rounded_lines,
+    ring,
+    feedback,
+  };
+  // one size for all, a ring keeps its center and radii in rect
+  struct Command {
+    Op op;
+    u32 index;  // mine number, tile, character, UI, segments or source
+    rl::Rect rect;
+    rl::Color color;
+    float a;  // roundness or start angle
+    float b;  // thickness or end angle
+  };
+  std::vector<Command> commands;
+  struct Source {
+    rl::Rect last;
+    rl::Rect own;
+  };
+  std::vector<Source> sources;  // of feedback, rarely any
+};
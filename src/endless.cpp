@@ -0,0 +1,181 @@
+#include "endless.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "logic.hpp"
+#include "profiler.hpp"
+
+// boards kept above the root, so zooming out never runs out of parents
+static constexpr u32 margin_up = 3;
+// boards in the window. Portals shrink boards quickly, by the end of the
+// window they're well below a pixel
+static constexpr u32 window = 16;
+// how far the root may wander from margin_up before the window moves
+static constexpr u32 slack = 2;
+// one more board past each end of the window. Cells on the window's end
+// boards neighbor cells of the next board out, they only count right with it
+// there. The root never gets close enough to a guard to show its outer edge
+static constexpr u32 guard = 1;
+// boards the level holds
+static constexpr u32 held = window + 2 * guard;
+// boards of progress remembered outside the window, ~330KB at the default
+// size
+static constexpr u32 max_deltas = 1 << 12;
+
+// every board has as many, whatever its depth
+static u32 MinesPerBoard(const EndlessParams& params) {
+  auto overlap = [](i32 from, i32 length, i32 size) {
+    return std::max(std::min(from + length, size) - std::max(from, 0), 0);
+  };
+  u32 portal = overlap(params.portal_x, params.portal_w, params.width) *
+               overlap(params.portal_y, params.portal_h, params.height);
+  u32 free = params.width * params.height - portal;
+  return std::min((u32)std::round(free * params.density), free);
+}
+
+static Board GenerateBoard(const EndlessParams& params, u64 seed, i64 depth) {
+  auto board = Board{params.width, params.height};
+
+  for (i32 y = 0; y < (i32)board.height; y++) {
+    for (i32 x = 0; x < (i32)board.width; x++) {
+      bool in_portal = x >= params.portal_x &&
+                       x < params.portal_x + params.portal_w &&
+                       y >= params.portal_y &&
+                       y < params.portal_y + params.portal_h;
+      if (!in_portal) board.Set(x, y, Cell{});
+    }
+  }
+
+  // every board has a generator of its own, so regenerating it reproduces it
+  // exactly no matter in which order boards were visited
+  auto rng = Rng{seed ^ ((u64)depth * 0xd1b54a32d192ed03ull)};
+  rng.Next();
+  u32 mines = MinesPerBoard(params);
+  while (mines > 0) {
+    i32 x = rng.Range(0, board.width - 1);
+    i32 y = rng.Range(0, board.height - 1);
+    auto* optional_cell = board.Get(x, y);
+    if (!optional_cell || optional_cell->mine) continue;
+    optional_cell->mine = true;
+    mines--;
+  }
+  return board;
+}
+
+void Endless::Fill(Level& level) {
+  PROFILE_ZONE("Endless::Fill");
+  auto& endless = level.endless.value();
+  auto& params = endless.params;
+
+  level.boards.clear();
+  level.portals.clear();
+  for (u32 i = 0; i < held; i++) {
+    i64 depth = endless.base_depth + i;
+    level.boards.push_back(GenerateBoard(params, level.seed, depth));
+
+    auto delta = endless.deltas.find(depth);
+    if (delta != endless.deltas.end()) {
+      auto& board = level.boards.back();
+      auto& cells = delta->second.cells;
+      for (u32 j = 0; j < cells.size(); j++)
+        board.Set(j % board.width, j / board.width, Cell::Unpack(cells[j]));
+    }
+
+    if (i + 1 < held) {
+      level.portals.push_back(Portal{params.portal_x,
+                                     params.portal_y,
+                                     params.portal_w,
+                                     params.portal_h,
+                                     i,
+                                     i + 1});
+    }
+  }
+
+  level.ResetNeighbors();
+  level.CalculateMineNumbers();
+
+  // there's no total, count the mines of every board seen so far. Each has
+  // the same amount, so the ones that left the window don't need generating
+  endless.seen_top = std::min(endless.seen_top, endless.base_depth);
+  endless.seen_bottom =
+      std::max(endless.seen_bottom, endless.base_depth + held - 1);
+  level.mine_left = MinesPerBoard(params) *
+                    (endless.seen_bottom - endless.seen_top + 1);
+  for (auto& board : level.boards) {
+    board.ForEachCell([&](i32, i32, Cell& cell) {
+      if (cell.flagged) level.mine_left--;
+    });
+  }
+  for (auto& [depth, delta] : endless.deltas) {
+    bool in_level =
+        depth >= endless.base_depth && depth < endless.base_depth + held;
+    if (!in_level) level.mine_left -= delta.flags;
+  }
+}
+
+void Endless::Build(Level& level, EndlessParams params) {
+  i64 top = -(i64)(guard + margin_up);
+  level.endless = EndlessState{params, top, top, top + held - 1, {}};
+  Fill(level);
+  level.root_board = guard + margin_up;
+}
+
+bool Endless::Update(Level& level) {
+  if (!level.endless) return false;
+  auto& endless = level.endless.value();
+
+  i64 shift = (i64)level.root_board - (guard + margin_up);
+  if (std::abs(shift) <= slack) return false;
+
+  // only boards the player did something on need remembering. One undone
+  // back to untouched forgets what it had
+  for (u32 i = 0; i < level.boards.size(); i++) {
+    auto& board = level.boards[i];
+    i64 depth = endless.base_depth + i;
+    bool touched = false;
+    u32 flags = 0;
+    board.ForEachCell([&](i32, i32, Cell& cell) {
+      if (!cell.covered || cell.flagged || cell.question_mark) touched = true;
+      flags += cell.flagged;
+    });
+    if (!touched) {
+      endless.deltas.erase(depth);
+      continue;
+    }
+
+    auto& delta = endless.deltas[depth];
+    delta.cells.assign(board.width * board.height, 0);
+    delta.flags = flags;
+    board.ForEachCell([&](i32 x, i32 y, Cell& cell) {
+      delta.cells[y * board.width + x] = cell.Pack();
+    });
+  }
+
+  endless.base_depth += shift;
+
+  // forgetting a board resets it, the window never comes near these again
+  // without a long way back
+  i64 center = endless.base_depth + guard + margin_up;
+  while (endless.deltas.size() > max_deltas) {
+    auto farthest = std::max_element(
+        endless.deltas.begin(), endless.deltas.end(), [&](auto& a, auto& b) {
+          return std::abs(a.first - center) < std::abs(b.first - center);
+        });
+    endless.deltas.erase(farthest);
+  }
+  Fill(level);
+  level.root_board = guard + margin_up;
+
+  // the root keeps its depth, so the camera stays as it is. Cell ids don't
+  for (auto* id : {&level.mouse_over, &level.mouse_over_last_frame}) {
+    if (!*id) continue;
+    i64 index = (i64)(*id)->board_index - shift;
+    if (index < 0 || index >= held)
+      *id = {};
+    else
+      (*id)->board_index = index;
+  }
+  level.UpdateBoardRectCache();
+  return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "fixed_size_int.hpp"
+
+// endless mode: an infinite chain of boards, each one holding the next one in
+// its portal. Only a window of boards around the root lives in the level,
+// everything else is regenerated from the seed when the camera comes back
+struct EndlessParams {
+  u32 width = 9;
+  u32 height = 9;
+  // hole leading into the next board, in cells of the current one
+  i32 portal_x = 3;
+  i32 portal_y = 3;
+  i32 portal_w = 3;
+  i32 portal_h = 3;
+  float density = 0.15f;  // of the cells outside the portal
+};
+
+struct EndlessState {
+  EndlessParams params;
+  i64 base_depth;  // depth of boards[0], deeper boards have bigger depth
+  // shallowest and deepest board that was ever in the level, mine_left
+  // counts the mines of all of them
+  i64 seen_top;
+  i64 seen_bottom;
+  struct Delta {
+    std::vector<u8> cells;  // Cell::Pack of every cell, void cells stay 0
+    u32 flags;
+  };
+  // revealed state of the boards the player touched, the only thing that
+  // grows while playing. Capped, the boards farthest away go first
+  std::unordered_map<i64, Delta> deltas;
+};
+
+class Level;
+namespace Endless {
+// fills a freshly reset level with the window around depth 0
+void Build(Level& level, EndlessParams params);
+
+// regenerates every board of the window, with the player's progress on top
+void Fill(Level& level);
+
+// moves the window along when the root board wandered too far from its
+// center, call after ChangeRootBoard. True if it did
+bool Update(Level& level);
+};  // namespace Endless
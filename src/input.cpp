@@ -0,0 +1,140 @@
+#include "input.hpp"
+
+#include "ssaa_window.hpp"
+
+// buttons raylib knows about, MOUSE_BUTTON_LEFT to MOUSE_BUTTON_BACK
+static constexpr int button_count = 7;
+
+static InputFrame current;
+
+void InputFrame::Merge(const InputFrame& later) {
+  time = later.time;
+  frame_time += later.frame_time;
+  mouse_position = later.mouse_position;
+  mouse_delta += later.mouse_delta;
+  wheel += later.wheel;
+  keys_down = later.keys_down;
+  keys_pressed |= later.keys_pressed;
+  buttons_down = later.buttons_down;
+  buttons_pressed |= later.buttons_pressed;
+  buttons_released |= later.buttons_released;
+  measure_memory = later.measure_memory;
+  // a resize anywhere in between still has to be noticed
+  bool was_resized = view.resized;
+  view = later.view;
+  view.resized = view.resized || was_resized;
+}
+
+void InputQueue::Push(const InputFrame& frame) {
+  {
+    std::lock_guard lock(mutex);
+    queue.push_back(frame);
+  }
+  wake.notify_one();
+}
+
+std::optional<InputFrame> InputQueue::Pop() {
+  std::unique_lock lock(mutex);
+  wake.wait(lock, [&] { return stop || !queue.empty(); });
+  if (stop) return {};
+
+  auto frame = queue.front();
+  for (size_t i = 1; i < queue.size(); i++) frame.Merge(queue[i]);
+  queue.clear();
+  return frame;
+}
+
+void InputQueue::Stop() {
+  {
+    std::lock_guard lock(mutex);
+    stop = true;
+  }
+  wake.notify_one();
+}
+
+namespace Input {
+
+InputFrame Capture(const View& view) {
+  InputFrame frame;
+  frame.time = ::GetTime();
+  frame.frame_time = ::GetFrameTime();
+  frame.mouse_position = ::GetMousePosition();
+  frame.mouse_delta = ::GetMouseDelta();
+  frame.wheel = ::GetMouseWheelMove();
+  // KEY_SPACE is the first printable key, everything below is unused
+  for (int key = KEY_SPACE; key < (int)frame.keys_down.size(); key++) {
+    frame.keys_down[key] = ::IsKeyDown(key);
+    frame.keys_pressed[key] = ::IsKeyPressed(key);
+  }
+  for (int button = 0; button < button_count; button++) {
+    frame.buttons_down |= ::IsMouseButtonDown(button) << button;
+    frame.buttons_pressed |= ::IsMouseButtonPressed(button) << button;
+    frame.buttons_released |= ::IsMouseButtonReleased(button) << button;
+  }
+  frame.view = view;
+  // raylib polled these at the end of the last EndDrawing, right before this
+  PROFILE_LATENCY(frame.latency, sampled);
+  return frame;
+}
+
+void Begin(const InputFrame& frame) {
+  current = frame;
+  canvas_size = frame.view.canvas_size;
+  window_size = frame.view.window_size;
+  canvas_capacity = frame.view.canvas_capacity;
+  inverse_aspect_ratio = frame.view.inverse_aspect_ratio;
+  ssaa_scale = frame.view.ssaa_scale;
+  ssaa_auto = frame.view.ssaa_auto;
+  resized = frame.view.resized;
+}
+
+bool IsKeyDown(int key) {
+  return key >= 0 && key < (int)current.keys_down.size() &&
+         current.keys_down[key];
+}
+
+bool IsKeyPressed(int key) {
+  return key >= 0 && key < (int)current.keys_pressed.size() &&
+         current.keys_pressed[key];
+}
+
+bool IsMouseButtonDown(int button) {
+  return current.buttons_down & (1 << button);
+}
+
+bool IsMouseButtonUp(int button) {
+  return !IsMouseButtonDown(button);
+}
+
+bool IsMouseButtonPressed(int button) {
+  return current.buttons_pressed & (1 << button);
+}
+
+bool IsMouseButtonReleased(int button) {
+  return current.buttons_released & (1 << button);
+}
+
+rl::Vector2 GetMousePosition() {
+  return current.mouse_position;
+}
+
+rl::Vector2 GetMouseDelta() {
+  return current.mouse_delta;
+}
+
+float GetMouseWheelMove() {
+  return current.wheel;
+}
+
+float GetFrameTime() {
+  return current.frame_time;
+}
+
+double GetTime() {
+  return current.time;
+}
+
+InputLatency& Latency() {
+  return current.latency;
+}
+};  // namespace Input
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <bitset>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "fixed_size_int.hpp"
+#include "profiler.hpp"
+#include "rl.hpp"
+
+// what the window looks like to the simulation. SSAAWindow keeps its own and
+// the globals in ssaa_window.hpp are only written from a captured one, so they
+// stay the simulation's no matter which thread it runs on
+struct View {
+  rl::Vector2 canvas_size;
+  rl::Vector2 window_size;
+  rl::Vector2 canvas_capacity;
+  float inverse_aspect_ratio;
+  float ssaa_scale;
+  bool ssaa_auto;
+  bool resized;
+};
+
+// everything the simulation reads from the player in one tick. raylib only
+// polls input on the thread owning the window, so it's gathered there
+struct InputFrame {
+  double time = 0.0;  // GetTime() when captured
+  float frame_time = 0.0f;
+  rl::Vector2 mouse_position = {0.0f, 0.0f};
+  rl::Vector2 mouse_delta = {0.0f, 0.0f};
+  float wheel = 0.0f;
+  std::bitset<512> keys_down;
+  std::bitset<512> keys_pressed;
+  u8 buttons_down = 0;
+  u8 buttons_pressed = 0;
+  u8 buttons_released = 0;
+  View view = {};
+  // the debug window shows the memory report, walking the level is only
+  // worth it then
+  bool measure_memory = false;
+  InputLatency latency;
+
+  // folds a later frame into this one, for a simulation that fell behind.
+  // Edges are kept, states are the later ones and movement adds up. Latency
+  // stays this one's, the oldest input waited the longest
+  void Merge(const InputFrame& later);
+};
+
+// hands frames from the window thread to the simulation thread in order
+class InputQueue {
+ public:
+  // the window rarely gets more than a few frames ahead
+  InputQueue() { queue.reserve(16); };
+
+  void Push(const InputFrame& frame);
+  // waits for at least one frame, returns everything queued merged into one.
+  // Empty once stopped
+  std::optional<InputFrame> Pop();
+  void Stop();
+
+ private:
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::vector<InputFrame> queue;  // a vector keeps its capacity
+  bool stop = false;
+};
+
+// the simulation side mirrors raylib's names, but answers from the frame
+// given to Begin instead of the window
+namespace Input {
+// window thread only
+InputFrame Capture(const View& view);
+
+// makes frame the current one and copies its view into the globals
+void Begin(const InputFrame& frame);
+
+bool IsKeyDown(int key);
+bool IsKeyPressed(int key);
+bool IsMouseButtonDown(int button);
+bool IsMouseButtonUp(int button);
+bool IsMouseButtonPressed(int button);
+bool IsMouseButtonReleased(int button);
+rl::Vector2 GetMousePosition();
+rl::Vector2 GetMouseDelta();
+float GetMouseWheelMove();
+float GetFrameTime();
+double GetTime();
+
+// the current frame's, for stamping the stages it goes through
+InputLatency& Latency();
+};  // namespace Input
@@ -0,0 +1,150 @@
+#include "level_loader.hpp"
+
+#include <exception>
+
+#include "input.hpp"
+#include "profiler.hpp"
+#include "rl.hpp"
+#include "serializer.hpp"
+#include "snapshot.hpp"
+
+// loads faster than this don't flash an indicator at all
+static constexpr double indicator_delay = 0.2;
+// prefetched levels nobody asked for are dropped after this many
+static constexpr u32 max_done = 2;
+
+bool LevelLoader::Job::Matches(const Job& other) const {
+  return name == other.name && completed_levels == other.completed_levels &&
+         resume == other.resume;
+}
+
+LevelLoader::LevelLoader() : worker(&LevelLoader::Work, this) {}
+
+LevelLoader::~LevelLoader() {
+  {
+    std::lock_guard lock(mutex);
+    stop = true;
+  }
+  wake.notify_all();
+  worker.join();
+}
+
+void LevelLoader::Request(std::string name, int completed_levels) {
+  auto job = Job{name,
+                 completed_levels,
+                 Serializer::NewSeed(),
+                 Snapshot::Exists(name)};
+  std::lock_guard lock(mutex);
+  wanted = job;
+  wanted_since = Input::GetTime();
+
+  // already loaded or on its way, e.g. prefetched next level
+  for (auto& result : done) {
+    if (result.job.Matches(job)) return;
+  }
+  if (working && working->Matches(job)) return;
+  for (auto& queued : queue) {
+    if (queued.Matches(job)) return;
+  }
+
+  // jump ahead of prefetches
+  queue.push_front(job);
+  wake.notify_one();
+}
+
+void LevelLoader::Prefetch(std::string name, int completed_levels) {
+  auto job = Job{name, completed_levels, Serializer::NewSeed()};
+  std::lock_guard lock(mutex);
+
+  for (auto& result : done) {
+    if (result.job.Matches(job)) return;
+  }
+  if (working && working->Matches(job)) return;
+  for (auto& queued : queue) {
+    if (queued.Matches(job)) return;
+  }
+
+  queue.push_back(job);
+  wake.notify_one();
+}
+
+bool LevelLoader::Poll(Level& level) {
+  std::unique_ptr<Level> loaded;
+  {
+    std::lock_guard lock(mutex);
+    if (!wanted) return false;
+
+    for (auto it = done.begin(); it != done.end(); it++) {
+      if (it->job.Matches(wanted.value())) {
+        loaded = std::move(it->level);
+        done.erase(it);
+        break;
+      }
+    }
+    if (!loaded) return false;
+    wanted = {};
+  }
+
+  // the swap itself happens between frames, so rendering never sees a half
+  // built level
+  level = std::move(*loaded);
+  Serializer::Activate(level);
+  return true;
+}
+
+bool LevelLoader::Pending() {
+  std::lock_guard lock(mutex);
+  return wanted.has_value();
+}
+
+bool LevelLoader::ShowIndicator() {
+  std::lock_guard lock(mutex);
+  return wanted && Input::GetTime() - wanted_since > indicator_delay;
+}
+
+void LevelLoader::Work() {
+  while (true) {
+    Job job;
+    {
+      std::unique_lock lock(mutex);
+      wake.wait(lock, [this] { return stop || !queue.empty(); });
+      if (stop) return;
+      job = queue.front();
+      queue.pop_front();
+      working = job;
+    }
+
+    PROFILE_ZONE("LevelLoader::Work");
+    auto level = std::make_unique<Level>();
+    bool ok = true;
+    try {
+      // a broken autosave falls back to a fresh game
+      if (!job.resume || !Snapshot::Read(*level))
+        Serializer::Parse(job.name, *level, job.completed_levels, job.seed);
+    } catch (std::exception& e) {
+      // most likely a typo while hot reloading levels.toml, keep playing the
+      // current level instead of crashing
+      TraceLog(LOG_WARNING,
+               "LOADER: failed to load level %s: %s",
+               job.name.c_str(),
+               e.what());
+      ok = false;
+    }
+
+    std::lock_guard lock(mutex);
+    working = {};
+    if (ok) {
+      done.push_back({job, std::move(level)});
+    } else if (wanted && wanted->Matches(job)) {
+      wanted = {};
+    }
+
+    // drop stale prefetches, oldest first, but never the one being waited on
+    for (auto it = done.begin(); done.size() > max_done && it != done.end();) {
+      if (wanted && it->job.Matches(wanted.value()))
+        it++;
+      else
+        it = done.erase(it);
+    }
+  }
+}
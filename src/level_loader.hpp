@@ -0,0 +1,65 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fixed_size_int.hpp"
+#include "logic.hpp"
+
+// parses levels on a worker thread so the current scene keeps animating while
+// the next one is built. Only Serializer::Parse runs on the worker, the camera
+// and other globals are touched in Poll on the simulation thread
+class LevelLoader {
+ public:
+  LevelLoader();
+  ~LevelLoader();
+
+  // the level the player wants next, replaces any earlier request. Resumes
+  // the autosave instead when it's an unfinished game of the same level
+  void Request(std::string name, int completed_levels = 0);
+
+  // speculative load, kept around until a matching Request picks it up
+  void Prefetch(std::string name, int completed_levels = 0);
+
+  // swaps the requested level in once it's ready, true when swapped
+  bool Poll(Level& level);
+
+  // a requested level hasn't been swapped in yet
+  bool Pending();
+
+  // only nag the player with a loading indicator on slow loads
+  bool ShowIndicator();
+
+ private:
+  struct Job {
+    std::string name;
+    int completed_levels;  // level selection looks different with progress
+    u64 seed;
+    bool resume = false;  // from the autosave instead of levels.toml
+
+    bool Matches(const Job& other) const;
+  };
+  struct Result {
+    Job job;
+    std::unique_ptr<Level> level;
+  };
+
+  void Work();
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::deque<Job> queue;
+  std::optional<Job> working;
+  std::vector<Result> done;
+  std::optional<Job> wanted;
+  double wanted_since;
+  bool stop = false;
+
+  std::thread worker;  // declared last, starts after everything above exists
+};
@@ -3,7 +3,11 @@
 #include <algorithm>
 #include <cmath>
 #include <iostream>
+#include <memory>
+#include <unordered_map>
 
+#include "input.hpp"
+#include "profiler.hpp"
 #include "rect_util.hpp"
 #include "scene.hpp"
 #include "serializer.hpp"
@@ -17,8 +21,7 @@ const Vec2i neighbor_deltas[8] =
       Vec2i{-1,  1}, Vec2i{ 0,  1}, Vec2i{ 1,  1},};
 // clang-format on
 
-// used with optional<Cell>&
-static optional<Cell> empty = {};
+bool portal_feedback = true;
 
 bool Board::Inside(Vec2i pos) {
   return (pos.x >= 0 && pos.x < width) && (pos.y >= 0 && pos.y < height);
@@ -31,61 +34,238 @@ rl::Rect Board::GetCellRect(Vec2i pos, rl::Rect board_rect) {
                   board_rect.height / height};
 }
 
-optional<Cell>& Board::Get(Vec2i pos) {
-  if (!Inside(pos)) {
-    return empty;
+// boards bigger than this go chunked, a 256x256 dense board is ~3MB already
+static constexpr u32 max_dense_cells = 256 * 256;
+
+Board::Board(u32 width, u32 height) : width(width), height(height) {
+  if ((u64)width * height <= max_dense_cells) {
+    cells = DenseCells{width, vector<optional<Cell>>(width * height)};
+    return;
   }
-  return cells[pos.y * width + pos.x];
+  u32 tile = ChunkedCells::tile_size;
+  auto chunked = ChunkedCells{(width + tile - 1) / tile,
+                              (height + tile - 1) / tile};
+  chunked.directory.resize(chunked.tiles_x * chunked.tiles_y);
+  cells = std::move(chunked);
+}
+
+Cell* Board::Get(Vec2i pos) {
+  if (!Inside(pos)) return nullptr;
+  auto* cell = std::visit(
+      [&](auto& storage) { return storage.Find(pos.x, pos.y); }, cells);
+  return cell && *cell ? &cell->value() : nullptr;
 }
 
-optional<Cell>& Board::Get(i32 x, i32 y) {
+Cell* Board::Get(i32 x, i32 y) {
   return Get(Vec2i{x, y});
 }
 
-optional<Cell>& Level::Get(CellID id) {
+void Board::Set(i32 x, i32 y, optional<Cell> cell) {
+  if (!Inside(Vec2i{x, y})) return;
+  // setting void where there's no tile shouldn't allocate one
+  if (!cell && !Get(x, y)) return;
+  std::visit([&](auto& storage) { storage.Create(x, y) = std::move(cell); },
+             cells);
+}
+
+bool Board::Chunked() const {
+  return std::holds_alternative<ChunkedCells>(cells);
+}
+
+u64 Board::StorageBytes() const {
+  if (auto* dense = std::get_if<DenseCells>(&cells))
+    return dense->cells.capacity() * sizeof(optional<Cell>);
+
+  auto& chunked = std::get<ChunkedCells>(cells);
+  u64 bytes = chunked.directory.capacity() * sizeof(chunked.directory[0]);
+  for (auto& tile : chunked.directory)
+    if (tile) bytes += sizeof(ChunkedCells::Tile);
+  return bytes;
+}
+
+optional<Cell>* ChunkedCells::Find(u32 x, u32 y) {
+  auto& tile = directory[(y >> tile_bits) * tiles_x + (x >> tile_bits)];
+  if (!tile) return nullptr;
+  return &(*tile)[Morton(x & (tile_size - 1), y & (tile_size - 1))];
+}
+
+optional<Cell>& ChunkedCells::Create(u32 x, u32 y) {
+  auto& tile = directory[(y >> tile_bits) * tiles_x + (x >> tile_bits)];
+  if (!tile) tile = std::make_unique<Tile>();
+  return (*tile)[Morton(x & (tile_size - 1), y & (tile_size - 1))];
+}
+
+enum CellBits : u8 {
+  exists = 1 << 0,
+  covered = 1 << 1,
+  safe = 1 << 2,
+  mine = 1 << 3,
+  flagged = 1 << 4,
+  question_mark = 1 << 5,
+};
+
+u8 Cell::Pack() const {
+  u8 bits = CellBits::exists;
+  if (covered) bits |= CellBits::covered;
+  if (safe) bits |= CellBits::safe;
+  if (mine) bits |= CellBits::mine;
+  if (flagged) bits |= CellBits::flagged;
+  if (question_mark) bits |= CellBits::question_mark;
+  return bits;
+}
+
+optional<Cell> Cell::Unpack(u8 bits) {
+  if (!(bits & CellBits::exists)) return {};
+  return Cell{
+      .covered = (bool)(bits & CellBits::covered),
+      .safe = (bool)(bits & CellBits::safe),
+      .mine = (bool)(bits & CellBits::mine),
+      .flagged = (bool)(bits & CellBits::flagged),
+      .question_mark = (bool)(bits & CellBits::question_mark),
+  };
+}
+
+Cell* Level::Get(CellID id) {
   return boards[id.board_index].Get(id.ToVec2i());
 }
 
 void Level::Tick() {
+  PROFILE_ZONE("Level::Tick");
+  frame_arena->Reset();
+  damaged = false;
   // slowly zoom out main menu
   if (name == "mainmenu") {
     auto target = CoordTransform::ScreenToWorld(
         rl::Vector2{2.0f / 3.0f, 0.5f * inverse_aspect_ratio});
-    float factor = GetFrameTime() * 0.1f + 1.0f;
+    float factor = Input::GetFrameTime() * 0.1f + 1.0f;
     camera_coord = target - (target - camera_coord) * factor;
     camera_zoom /= factor;
     camera_moved = true;
     CoordTransform::UpdateCameraWorldRect();
   }
 
-  if (started && state == State::gaming) {
-    time += GetFrameTime();
+  // the timer is part of the UI, which is drawn every frame anyway
+  if (started && state == State::gaming) time += Input::GetFrameTime();
+
+  if (Input::IsKeyPressed(KEY_F2)) {
+    portal_feedback = !portal_feedback;
+    UpdateBoardRectCache();
+    damaged = true;
   }
 
   if (camera_moved || resized) {
     ChangeRootBoard();
+    // the root can run into the end of the endless window mid zoom, carry on
+    // from the moved window
+    bool window_moved = false;
+    for (int i = 0; i < 8 && Endless::Update(*this); i++) {
+      ChangeRootBoard();
+      window_moved = true;
+    }
+    if (window_moved) {
+      history.clear();
+      history_at = 0;
+    }
   }
 
   RemoveHighLight();
 
   if (name == "mainmenu") return;
 
+  // Z undoes, Y redoes. Ctrl is taken by zooming in. Between removing and
+  // adding the highlight, a cell covered again with its neighbors still lit
+  // would keep them lit
+  if (Input::IsKeyPressed(KEY_Z)) Undo();
+  if (Input::IsKeyPressed(KEY_Y)) Redo();
+
   UpdateMouseOver();
+  if (mouse_over != mouse_over_last_frame) damaged = true;
   if (state == State::gaming) AddHighLight();
 
   HandleMouseInput();
+  PROFILE_LATENCY(Input::Latency(), handled);
 
-  if (winning_check_needed) {
+  // there's no winning an endless level, only getting deep
+  if (winning_check_needed && !endless) {
     CheckGameWon();
   }
 
-  if (state != State::gaming && IsKeyPressed(KEY_R)) {
-    Serializer::Load(name, *this);
+  if (state != State::gaming && Input::IsKeyPressed(KEY_R)) {
+    requested_load = name;
   };
+
+  if (name == "levelselection" && Input::IsKeyPressed(KEY_E)) {
+    requested_load = "endless";
+  }
+}
+
+u64 LevelMemory::Total() const {
+  return cell_bytes + neighbor_bytes + neighbor_slack + route_bytes +
+         zero_region_bytes + rect_cache_bytes + endless_bytes;
+}
+
+void Level::MeasureMemory(LevelMemory& memory) const {
+  memory.name = name;
+  memory.board_bytes.clear();
+  memory.cell_bytes = 0;
+  memory.chunked_boards = 0;
+  memory.tiles = 0;
+  for (auto& board : boards) {
+    u64 bytes = board.StorageBytes();
+    memory.board_bytes.push_back(bytes);
+    memory.cell_bytes += bytes;
+    if (auto* chunked = std::get_if<ChunkedCells>(&board.cells)) {
+      memory.chunked_boards++;
+      for (auto& tile : chunked->directory)
+        if (tile) memory.tiles++;
+    }
+  }
+
+  memory.neighbor_bytes = arena->bytes;
+  memory.neighbor_slack = arena->BlockBytes() - arena->bytes;
+  memory.route_bytes = neighbor_routes.capacity() * sizeof(neighbor_routes[0]) +
+                       neighbor_scratch.capacity() * sizeof(CellID);
+  for (auto& routes : neighbor_routes)
+    memory.route_bytes += routes.capacity() * sizeof(ExactBoardRect);
+  for (auto& bounds : neighbor_route_bounds)
+    memory.route_bytes += bounds.capacity() * sizeof(RouteBounds);
+  auto& regions = zero_regions;
+  memory.zero_region_bytes =
+      regions.boards.capacity() * sizeof(regions.boards[0]) +
+      regions.spans.capacity() * sizeof(regions.spans[0]) +
+      regions.slots.capacity() * sizeof(u16) +
+      (regions.parent.capacity() + regions.next.capacity() +
+       region_scratch.capacity()) *
+          sizeof(u32);
+  for (auto& index : regions.boards) {
+    memory.zero_region_bytes +=
+        index.dense.capacity() * sizeof(u32) +
+        index.tiles.capacity() * sizeof(index.tiles[0]);
+    for (auto& tile : index.tiles)
+      if (tile) memory.zero_region_bytes += sizeof(ZeroRegions::Tile);
+  }
+
+  memory.portals = portals.size();
+  memory.clone_portals = 0;
+  for (auto& portal : portals)
+    if (portal.clone) memory.clone_portals++;
+
+  memory.rect_cache_entries = board_rect_cache.size();
+  memory.rect_cache_bytes = board_rect_cache.capacity() * sizeof(BoardRectInfo);
+
+  memory.endless_bytes = 0;
+  if (endless) {
+    for (auto& [depth, delta] : endless->deltas)
+      memory.endless_bytes += sizeof(depth) + delta.cells.capacity();
+  }
 }
 
-vector<pair<Portal&, BoardRectInfo>> Level::GetParentRectInfo(
-    u32 index, bool non_clone_only) {
+optional<i64> Level::EndlessDepth() {
+  if (!endless) return {};
+  return endless->base_depth + root_board;
+}
+
+Level::RectInfos Level::GetParentRectInfo(u32 index, bool non_clone_only) {
   return GetParentRectInfo(
       BoardRectInfo{
           index,
@@ -94,15 +274,15 @@ vector<pair<Portal&, BoardRectInfo>> Level::GetParentRectInfo(
       non_clone_only);
 }
 
-vector<pair<Portal&, BoardRectInfo>> Level::GetChildRectInfo(u32 index) {
+Level::RectInfos Level::GetChildRectInfo(u32 index) {
   return GetChildRectInfo(BoardRectInfo{
       index,
       rl::Rect{0, 0, (float)boards[index].width, (float)boards[index].height}});
 }
 
-vector<pair<Portal&, BoardRectInfo>> Level::GetParentRectInfo(
-    BoardRectInfo info, bool non_clone_only) {
-  vector<pair<Portal&, BoardRectInfo>> vector = {};
+Level::RectInfos Level::GetParentRectInfo(BoardRectInfo info,
+                                          bool non_clone_only) {
+  RectInfos vector{frame_arena.get()};
   for (auto& portal : portals) {
     // second one always eval to true when non-clone-only is false
     if (portal.to == info.index && (portal.clone == false || !non_clone_only)) {
@@ -123,9 +303,8 @@ vector<pair<Portal&, BoardRectInfo>> Level::GetParentRectInfo(
   return vector;
 }
 
-vector<pair<Portal&, BoardRectInfo>> Level::GetChildRectInfo(
-    BoardRectInfo info) {
-  vector<pair<Portal&, BoardRectInfo>> vector = {};
+Level::RectInfos Level::GetChildRectInfo(BoardRectInfo info) {
+  RectInfos vector{frame_arena.get()};
   for (auto& portal : portals) {
     if (portal.from == info.index) {
       Board& parent = boards[portal.from];
@@ -148,27 +327,89 @@ vector<pair<Portal&, BoardRectInfo>> Level::GetChildRectInfo(
   return vector;
 }
 
-void Level::ChangeRootBoard() {
-  static constexpr u32 max_root_board_change = 1;
-
-  for (int i = 0; i < max_root_board_change; i++) {
-    if (!ChangeRootBoardOnce()) break;
+// boards the root moves in a frame at most. The limit only stops a broken
+// level from hanging
+static constexpr u32 max_root_board_change = 256;
+
+u32 Level::ChangeRootBoard() {
+  PROFILE_ZONE("Level::ChangeRootBoard");
+
+  // every hop composes its portal's step onto view, the camera itself is
+  // only transformed once at the end. Re-expressing it per hop rounded it to
+  // float every time, which drifted on long dives
+  auto view = RootView{root_board};
+  u32 hops = 0;
+  while (hops < max_root_board_change) {
+    u32 moved = StepRootBoard(view);
+    if (moved == 0) break;
+    hops += moved;
   }
+  if (hops == 0) return 0;
+
+  camera_coord = rl::Vector2{(float)(camera_coord.x * view.scale + view.x),
+                             (float)(camera_coord.y * view.scale + view.y)};
+  camera_zoom = camera_zoom / view.scale;
+  CoordTransform::UpdateCameraWorldRect();
+  if (drawn_view) {
+    auto& drawn = drawn_view.value();
+    drawn.scale /= view.scale;
+    drawn.x -= view.x * drawn.scale;
+    drawn.y -= view.y * drawn.scale;
+  }
+  root_board = view.board;
+  // once for all the hops
+  UpdateBoardRectCache();
+  return hops;
 }
 
-bool Level::ChangeRootBoardOnce() {
+u32 Level::StepRootBoard(RootView& view) {
+  // the camera as the candidate sees it, straight from the current root's
+  auto world = camera_world_rect;
+  auto camera_rect = rl::Rect{(float)(world.x * view.scale + view.x),
+                              (float)(world.y * view.scale + view.y),
+                              (float)(world.width * view.scale),
+                              (float)(world.height * view.scale)};
+  float zoom = camera_zoom / view.scale;
+
   auto root_rect = rl::Rect{
-      0, 0, (float)boards[root_board].width, (float)boards[root_board].height};
-  rl::Rect root_rect_clipped =
-      RectUtil::boolean_and(camera_world_rect, root_rect);
+      0, 0, (float)boards[view.board].width, (float)boards[view.board].height};
+  rl::Rect root_rect_clipped = RectUtil::boolean_and(camera_rect, root_rect);
   float root_rect_clipped_size =
       root_rect_clipped.width * root_rect_clipped.height;
 
   // go up one layer when not covering the full screen, AND clipped area
   // becomes bigger
-  if (!RectUtil::is_inside(root_rect, camera_world_rect)) {
+  if (!RectUtil::is_inside(root_rect, camera_rect)) {
+    // no ancestor smaller than the camera can hold it, the probing below
+    // would pass them all one by one. The scales along the parent chain say
+    // how far up the first one it fits in is, go to the board right below
+    // it at once. The last hop is the probing's, it rounds like the way down
+    // does and they can't disagree
+    auto up = view;
+    u32 skipped = 0;
+    while (skipped < max_root_board_change) {
+      auto parent = parent_portals[up.board];
+      if (!parent) break;
+      auto& portal = portals[*parent];
+      double scale = portal_scales[*parent];
+      // the parent's size as up sees it
+      auto& from = boards[portal.from];
+      if (from.width * scale >= world.width * up.scale &&
+          from.height * scale >= world.height * up.scale)
+        break;
+      up.scale /= scale;
+      up.x = up.x / scale + portal.x;
+      up.y = up.y / scale + portal.y;
+      up.board = portal.from;
+      skipped++;
+    }
+    if (skipped) {
+      view = up;
+      return skipped;
+    }
+
     // should only contain 0 or 1 element
-    auto portal_AND_infos = GetParentRectInfo(root_board, true);
+    auto portal_AND_infos = GetParentRectInfo(view.board, true);
 
     // edge case: sometimes going up one layer the clipped area wouldn't become
     // bigger but more times would, see level 5
@@ -178,11 +419,10 @@ bool Level::ChangeRootBoardOnce() {
     // when size < go_up, the uppmost board has been reached
     while (go_up <= max_go_up && portal_AND_infos.size() == go_up) {
       auto& portal_AND_info = portal_AND_infos.back();
-      auto& portal = portal_AND_info.first;
       auto& rect_info = portal_AND_info.second;
 
       auto parent_rect_clipped =
-          RectUtil::boolean_and(camera_world_rect, rect_info.rect);
+          RectUtil::boolean_and(camera_rect, rect_info.rect);
       auto parent_rect_clipped_size =
           parent_rect_clipped.width * parent_rect_clipped.height;
       // size tolerance
@@ -201,63 +441,53 @@ bool Level::ChangeRootBoardOnce() {
     }
 
     if (need_to_go_up) {
-      float last_width = boards[root_board].width;
-
       for (auto& portal_AND_info : portal_AND_infos) {
         auto& portal = portal_AND_info.first;
-        auto& rect_info = portal_AND_info.second;
-        float scale = last_width / portal.width;
-        last_width = boards[rect_info.index].width;
-        camera_coord /= scale;
-        camera_coord.x += portal.x;
-        camera_coord.y += portal.y;
-        camera_zoom *= scale;
-        root_board = portal.from;
+        double scale = portal_scales[&portal - portals.data()];
+        view.scale /= scale;
+        view.x = view.x / scale + portal.x;
+        view.y = view.y / scale + portal.y;
+        view.board = portal.from;
       }
-      CoordTransform::UpdateCameraWorldRect();
-      UpdateBoardRectCache();
-      return true;
+      return portal_AND_infos.size();
     }
   }
   // go down one layer when child covering full screen, OR clipped area doesn't
   // become smaller, AND wouldn't exceed zoom limit
   // don't you love edge cases
-  auto portal_AND_infos = GetChildRectInfo(root_board);
+  auto portal_AND_infos = GetChildRectInfo(view.board);
 
   for (auto& portal_AND_info : portal_AND_infos) {
     auto& portal = portal_AND_info.first;
     auto& child_rect_info = portal_AND_info.second;
 
     // skip when it isn't in screen
-    if (!child_rect_info.rect.CheckCollision(camera_world_rect)) continue;
+    if (!child_rect_info.rect.CheckCollision(camera_rect)) continue;
 
     auto& child_rect = child_rect_info.rect;
-    auto child_rect_clipped =
-        RectUtil::boolean_and(camera_world_rect, child_rect);
+    auto child_rect_clipped = RectUtil::boolean_and(camera_rect, child_rect);
     auto child_rect_clipped_size =
         child_rect_clipped.width * child_rect_clipped.height;
 
-    if (RectUtil::is_inside(child_rect_info.rect, camera_world_rect) ||
+    if (RectUtil::is_inside(child_rect_info.rect, camera_rect) ||
         child_rect_clipped_size > root_rect_clipped_size) {
-      float scale = (float)(boards[child_rect_info.index].width) / portal.width;
+      double scale = portal_scales[&portal - portals.data()];
 
       // test if reaching zoom limit
-      if (camera_zoom / scale < zoom_min) continue;
+      if (zoom / scale < zoom_min) continue;
 
-      camera_coord.x -= portal.x;
-      camera_coord.y -= portal.y;
-      camera_coord *= scale;
-      camera_zoom /= scale;
-      CoordTransform::UpdateCameraWorldRect();
-      root_board = portal.to;
-      UpdateBoardRectCache();
-      return true;
+      view.scale *= scale;
+      view.x = (view.x - portal.x) * scale;
+      view.y = (view.y - portal.y) * scale;
+      view.board = portal.to;
+      return 1;
     }
   }
-  return false;
+  return 0;
 }
 
 void Level::UpdateBoardRectCache() {
+  PROFILE_ZONE("Level::UpdateBoardRectCache");
   static constexpr u32 max_cache = 255;
 
   auto root_rect_info =
@@ -268,21 +498,26 @@ void Level::UpdateBoardRectCache() {
                              (float)boards[root_board].height}};
   board_rect_cache.clear();
 
-  vector<BoardRectInfo> buffer = {root_rect_info};
-  vector<BoardRectInfo> backbuffer;
+  std::pmr::vector<BoardRectInfo> buffer{{root_rect_info}, frame_arena.get()};
+  std::pmr::vector<BoardRectInfo> backbuffer{frame_arena.get()};
 
   while (!buffer.empty()) {
     for (auto& info : buffer) {
+      u32 self = board_rect_cache.size();
       board_rect_cache.push_back(info);
+      // whatever is inside comes along with the copied pixels
+      if (info.feedback) continue;
 
       auto portal_AND_infos = GetChildRectInfo(info);
       for (auto& portal_AND_info : portal_AND_infos) {
         auto& child_info = portal_AND_info.second;
+        child_info.parent = self;
 
         float size_on_screen =
             std::max(child_info.rect.width * camera_zoom * canvas_size.x,
                      child_info.rect.height * camera_zoom * canvas_size.x);
         if (size_on_screen > 0.004f && board_rect_cache.size() <= max_cache) {
+          child_info.feedback = FindFeedbackSource(child_info);
           backbuffer.push_back(child_info);
         }
       }
@@ -292,6 +527,28 @@ void Level::UpdateBoardRectCache() {
   }
 }
 
+optional<u32> Level::FindFeedbackSource(const BoardRectInfo& info) {
+  // anything bigger is close enough to the camera that last frame's pixels
+  // would show, and is still worth clicking into
+  static constexpr float max_screen_width = 0.125f;
+  // nothing was drawn of this level yet, the canvas still shows another one
+  if (!portal_feedback || !drawn_view) return {};
+  if (info.rect.width * camera_zoom > max_screen_width) return {};
+
+  // an instance of the same board looks exactly the same, portals included.
+  // It has to be fully on screen to have all of its pixels in the canvas,
+  // both the one of the last Draw and the one this Draw settles into
+  auto canvas = rl::Rect{0, 0, canvas_size.x, canvas_size.y};
+  for (u32 i = info.parent;; i = board_rect_cache[i].parent) {
+    auto& ancestor = board_rect_cache[i];
+    if (ancestor.index == info.index && !ancestor.feedback &&
+        RectUtil::is_inside(camera_world_rect, ancestor.rect) &&
+        RectUtil::is_inside(canvas, drawn_view->ToPixel(ancestor.rect)))
+      return i;
+    if (i == 0) return {};
+  }
+}
+
 bool PortalRecord::RejectRoute(Portal& portal, bool go_up) {
   if (!this->portal) return false;
 
@@ -305,171 +562,286 @@ bool PortalRecord::RejectRoute(Portal& portal, bool go_up) {
   return false;
 }
 
-void Level::CalculateNeighbors() {
-  static constexpr u32 max_depth = 4;
-  static constexpr u32 max_cache = 63;
+static ExactBoardRect ChildRect(Portal& portal,
+                                Board& parent,
+                                const ExactBoardRect& info) {
+  // same as GetChildRectInfo
+  Rational cell_size_parent = info.rect.width / parent.width;
+  return {portal.to,
+          {info.rect.x + cell_size_parent * portal.x,
+           info.rect.y + cell_size_parent * portal.y,
+           info.rect.width * portal.width / parent.width,
+           info.rect.height * portal.height / parent.height}};
+}
 
-  for (u32 board_index = 0; board_index < boards.size(); board_index++) {
-    auto& board = boards[board_index];
-    auto root_board_info =
-        BoardRectInfo{board_index,
-                      rl::Rect{0,
-                               0,
-                               (float)boards[board_index].width,
-                               (float)boards[board_index].height}};
-
-    vector<BoardRectInfo> board_rect_infos;
-    vector<PortalRecord> buffer = {{{}, false, 0, root_board_info}};
-    vector<PortalRecord> backbuffer;
-
-    while (!buffer.empty()) {
-      for (auto& record : buffer) {
-        board_rect_infos.push_back(record.board_info);
-        if (record.depth >= max_depth) continue;  // no more child
-
-        auto portal_AND_infos = GetChildRectInfo(record.board_info);
-        for (auto& portal_AND_info : portal_AND_infos) {
-          auto& portal = portal_AND_info.first;
-          auto& child_info = portal_AND_info.second;
-
-          if (!record.RejectRoute(portal, /*go_up = */ false) &&
-              board_rect_infos.size() <= max_cache) {
-            backbuffer.push_back(
-                {&portal, /*.go_up = */ false, record.depth + 1, child_info});
-          }
-        }
+static ExactBoardRect ParentRect(Portal& portal,
+                                 Board& parent,
+                                 const ExactBoardRect& info) {
+  // same as GetParentRectInfo
+  Rational size = info.rect.width / portal.width;
+  return {portal.from,
+          {info.rect.x - size * portal.x,
+           info.rect.y - size * portal.y,
+           size * parent.width,
+           size * parent.height}};
+}
 
-        // don't go up with cloned boards, period. causes endless edge cases and
-        // headaches
-        // if (boards[record.board_info.index].has_clones) continue;
-        portal_AND_infos = GetParentRectInfo(record.board_info, true);
-        for (auto& portal_AND_info : portal_AND_infos) {
-          auto& portal = portal_AND_info.first;
-          auto& parent_info = portal_AND_info.second;
-          if (!record.RejectRoute(portal, /*go_up*/ true) &&
-              board_rect_infos.size() <= max_cache) {
-            backbuffer.push_back(
-                {&portal, /*.go_up*/ true, record.depth + 1, parent_info});
-          }
-        }
-      }
-      buffer.clear();
-      buffer.swap(backbuffer);
-    }
-    // delete root rect, its collision is handled by offsetting the
-    // coord like other minesweeper games
-    board_rect_infos.erase(board_rect_infos.begin());
-
-    for (i32 x = 0; x < board.width; x++) {
-      for (i32 y = 0; y < board.height; y++) {
-        auto& optional_cell = board.Get(x, y);
-        if (!optional_cell) continue;
-        auto& cell = optional_cell.value();
-
-        // calculate neighbors on this board
-        for (auto& offset : neighbor_deltas) {
-          auto& optional_neighbor = board.Get(x + offset.x, y + offset.y);
-          if (!optional_neighbor) continue;
-          cell.neighbors.push_back(
-              CellID{x + offset.x, y + offset.y, board_index});
-        }
+void Level::ResetNeighbors() {
+  arena->Release();
+  neighbor_routes.assign(boards.size(), {});
+  neighbor_route_bounds.assign(boards.size(), {});
+  routes_known = false;
+  portal_scales.resize(portals.size());
+  parent_portals.assign(boards.size(), {});
+  for (u32 i = 0; i < portals.size(); i++) {
+    portal_scales[i] = (double)boards[portals[i].to].width / portals[i].width;
+    if (!portals[i].clone && !parent_portals[portals[i].to])
+      parent_portals[portals[i].to] = i;
+  }
+  BuildZeroRegions();
+}
 
-        // the expensive part. Calculate by brute forcing rect collisions
-        auto cell_rect = rl::Rect{x - 0.001f, y - 0.001f, 1.002f, 1.002f};
-        for (auto& board_rect_info : board_rect_infos) {
-          // overloading board, board_index, x, and y because not doing so
-          // is even more confusing
-          auto board_index = board_rect_info.index;
-          auto& board = boards[board_index];
-          for (i32 x = 0; x < board.width; x++) {
-            for (i32 y = 0; y < board.height; y++) {
-              auto collision_rect =
-                  board.GetCellRect(Vec2i{x, y}, board_rect_info.rect);
-              if (board.Get(x, y) && cell_rect.CheckCollision(collision_rect)) {
-                auto id = CellID{x, y, board_index};
-
-                // unique neighbors
-                if (std::find(cell.neighbors.begin(),
-                              cell.neighbors.end(),
-                              id) == cell.neighbors.end()) {
-                  cell.neighbors.push_back(id);
-                }
-              }
+// other's cells touching [left, right] × [top, bottom] of the board route
+// starts from, edges and corners included. No search, no epsilon. Half open
+// like ForEachCellIn
+struct CellRange {
+  i64 x0, y0, x1, y1;
+};
+static CellRange CellsTouching(const ExactBoardRect& route,
+                               const Board& other,
+                               i64 left,
+                               i64 top,
+                               i64 right,
+                               i64 bottom) {
+  Rational cell_width = route.rect.width / other.width;
+  Rational cell_height = route.rect.height / other.height;
+  i64 x0 = ((left - route.rect.x) / cell_width).Ceil() - 1;
+  i64 x1 = ((right - route.rect.x) / cell_width).Floor() + 1;
+  i64 y0 = ((top - route.rect.y) / cell_height).Ceil() - 1;
+  i64 y1 = ((bottom - route.rect.y) / cell_height).Floor() + 1;
+  return {std::clamp<i64>(x0, 0, other.width),
+          std::clamp<i64>(y0, 0, other.height),
+          std::clamp<i64>(x1, 0, other.width),
+          std::clamp<i64>(y1, 0, other.height)};
+}
+
+const vector<ExactBoardRect>& Level::NeighborRoutes(u32 board_index) {
+  if (routes_known) return neighbor_routes[board_index];
+  routes_known = true;
+  for (u32 i = 0; i < boards.size(); i++) SearchRoutes(i, neighbor_routes[i]);
+
+  // the search is capped, A can reach B while B runs out before reaching A.
+  // Neighbors have to go both ways, so every route gets its way back too
+  for (u32 from = 0; from < boards.size(); from++) {
+    // appending to this board's own routes when it routes to itself
+    for (u32 i = 0, count = neighbor_routes[from].size(); i < count; i++) {
+      auto route = neighbor_routes[from][i];
+      auto& to = boards[route.index];
+      auto& rect = route.rect;
+      // from's rect as seen from to
+      Rational scale_x = Rational{to.width} / rect.width;
+      Rational scale_y = Rational{to.height} / rect.height;
+      auto back = ExactBoardRect{from,
+                                 {Rational{0} - rect.x * scale_x,
+                                  Rational{0} - rect.y * scale_y,
+                                  boards[from].width * scale_x,
+                                  boards[from].height * scale_y}};
+      auto& others = neighbor_routes[route.index];
+      bool known =
+          std::any_of(others.begin(), others.end(), [&](auto& other) {
+            return other.index == back.index &&
+                   other.rect.x == back.rect.x &&
+                   other.rect.y == back.rect.y &&
+                   other.rect.width == back.rect.width &&
+                   other.rect.height == back.rect.height;
+          });
+      if (!known) others.push_back(back);
+    }
+  }
+  for (u32 i = 0; i < boards.size(); i++) {
+    auto& board = boards[i];
+    for (auto& route : neighbor_routes[i]) {
+      auto& rect = route.rect;
+      RouteBounds bounds{rect.x.Floor(),
+                         rect.y.Floor(),
+                         (rect.x + rect.width).Ceil(),
+                         (rect.y + rect.height).Ceil()};
+
+      // a parent's route covers the whole board, but usually all it has
+      // under the board's inner cells is void. Then only the outer ring
+      // can reach it
+      bool covers = bounds.left <= 0 && bounds.top <= 0 &&
+                    bounds.right >= board.width &&
+                    bounds.bottom >= board.height;
+      if (covers && board.width > 2 && board.height > 2) {
+        auto& other = boards[route.index];
+        auto inner = CellsTouching(
+            route, other, 1, 1, board.width - 1, board.height - 1);
+        bounds.ring_only = true;
+        for (i64 y = inner.y0; y < inner.y1 && bounds.ring_only; y++) {
+          for (i64 x = inner.x0; x < inner.x1; x++) {
+            if (other.Get(x, y)) {
+              bounds.ring_only = false;
+              break;
             }
           }
         }
       }
+      neighbor_route_bounds[i].push_back(bounds);
     }
   }
+  return neighbor_routes[board_index];
+}
 
-  // The final duct tape. Ensures bidirectionality so if the above code missed
-  // some cells this has a chance to save it
-  for (u32 board_index = 0; board_index < boards.size(); board_index++) {
-    auto& board = boards[board_index];
-    for (i32 x = 0; x < board.width; x++) {
-      for (i32 y = 0; y < board.height; y++) {
-        if (!board.Get(x, y)) continue;
-        auto& cell = board.Get(x, y).value();
-        auto id = CellID{x, y, board_index};
-
-        for (auto& neighbor : cell.neighbors) {
-          auto& neighbor_cell_neighbors = Get(neighbor).value().neighbors;
-          if (std::find(neighbor_cell_neighbors.begin(),
-                        neighbor_cell_neighbors.end(),
-                        id) == neighbor_cell_neighbors.end()) {
-            neighbor_cell_neighbors.push_back(id);
-          }
+void Level::SearchRoutes(u32 board_index, vector<ExactBoardRect>& routes) {
+  static constexpr u32 max_depth = 4;
+  static constexpr u32 max_cache = 63;
+
+  auto& board = boards[board_index];
+  auto root_board_info = ExactBoardRect{
+      board_index, {0, 0, (i64)board.width, (i64)board.height}};
+
+  std::pmr::vector<PortalRecord> buffer{{{{}, false, 0, root_board_info}},
+                                        frame_arena.get()};
+  std::pmr::vector<PortalRecord> backbuffer{frame_arena.get()};
+
+  while (!buffer.empty()) {
+    for (auto& record : buffer) {
+      auto& info = record.board_info;
+      routes.push_back(info);
+      if (record.depth >= max_depth) continue;  // no more child
+
+      for (auto& portal : portals) {
+        if (portal.from != info.index) continue;
+        if (!record.RejectRoute(portal, /*go_up = */ false) &&
+            routes.size() <= max_cache) {
+          backbuffer.push_back({&portal,
+                                /*.go_up = */ false,
+                                record.depth + 1,
+                                ChildRect(portal, boards[info.index], info)});
+        }
+      }
+
+      // clone portals too, unlike the camera. A cell next to a clone portal
+      // touches the clone's edge cells, so they have to see it back
+      for (auto& portal : portals) {
+        if (portal.to != info.index) continue;
+        if (!record.RejectRoute(portal, /*go_up*/ true) &&
+            routes.size() <= max_cache) {
+          backbuffer.push_back({&portal,
+                                /*.go_up*/ true,
+                                record.depth + 1,
+                                ParentRect(portal, boards[portal.from], info)});
         }
       }
     }
+    buffer.clear();
+    buffer.swap(backbuffer);
   }
+  // delete root rect, its collision is handled by offsetting the
+  // coord like other minesweeper games
+  routes.erase(routes.begin());
 }
 
-void Level::CalculateMineNumbers(bool override) {
-  for (auto& board : boards) {
-    for (i32 x = 0; x < board.width; x++) {
-      for (i32 y = 0; y < board.height; y++) {
-        if (!board.Get(x, y)) continue;
-        auto& cell = board.Get(x, y).value();
-
-        // Don't override at level selection and level generation, but do so
-        // when repositioning the first-click mine
-        if (override == false) {
-          if (cell.number != 0) continue;
-        }
-        cell.number = 0;
+std::span<CellID> Level::Neighbors(CellID id) {
+  auto& cell = *Get(id);
+  if (cell.neighbors_known) return cell.neighbors;
 
-        for (auto& neighbor : cell.neighbors) {
-          if (Get(neighbor).value().mine) {
-            cell.number++;
-          }
-        }
+  auto found = FindNeighbors(id);
+  auto* data = arena->Allocate<CellID>(found.size());
+  std::uninitialized_copy(found.begin(), found.end(), data);
+  cell.neighbors = {data, found.size()};
+  cell.neighbors_known = true;
+  return cell.neighbors;
+}
+
+std::span<CellID> Level::FindNeighbors(CellID id) {
+  auto& cell = *Get(id);
+  if (cell.neighbors_known) return cell.neighbors;
+
+  auto& neighbors = neighbor_scratch;
+  neighbors.clear();
+
+  // calculate neighbors on this board
+  auto& board = boards[id.board_index];
+  for (auto& offset : neighbor_deltas) {
+    if (!board.Get(id.x + offset.x, id.y + offset.y)) continue;
+    neighbors.push_back(
+        CellID{id.x + offset.x, id.y + offset.y, id.board_index});
+  }
+
+  auto& routes = NeighborRoutes(id.board_index);
+  auto& bounds = neighbor_route_bounds[id.board_index];
+  bool inner = id.x > 0 && id.y > 0 && id.x < board.width - 1 &&
+               id.y < board.height - 1;
+  for (u32 i = 0; i < routes.size(); i++) {
+    auto& route = routes[i];
+    if (id.x + 1 < bounds[i].left || id.x > bounds[i].right ||
+        id.y + 1 < bounds[i].top || id.y > bounds[i].bottom ||
+        (inner && bounds[i].ring_only))
+      continue;
+
+    auto& other = boards[route.index];
+    auto r = CellsTouching(route, other, id.x, id.y, id.x + 1, id.y + 1);
+    other.ForEachCellIn(r.x0, r.y0, r.x1, r.y1, [&](i32 x, i32 y, Cell&) {
+      auto neighbor = CellID{x, y, route.index};
+      if (neighbor == id) return;
+      // unique neighbors
+      if (std::find(neighbors.begin(), neighbors.end(), neighbor) ==
+          neighbors.end()) {
+        neighbors.push_back(neighbor);
       }
-    }
+    });
+  }
+
+  return neighbors;
+}
+
+u32 Level::CountMines(CellID id) {
+  u32 mines = 0;
+  for (auto& neighbor : Neighbors(id)) {
+    if (Get(neighbor)->mine) mines++;
+  }
+  return mines;
+}
+
+void Level::CalculateMineNumbers(bool override) {
+  for (u32 board_index = 0; board_index < boards.size(); board_index++) {
+    boards[board_index].ForEachCell([&](i32 x, i32 y, Cell& cell) {
+      if (cell.covered) return;
+      // Don't override at level selection and level generation, but do so
+      // when repositioning the first-click mine
+      if (override == false) {
+        if (cell.number != 0) return;
+      }
+      cell.number = CountMines(CellID{x, y, board_index});
+    });
   }
 }
 
 void Level::RemoveHighLight() {
   if (!mouse_over) return;
-  auto& cell = Get(mouse_over.value()).value();
+  auto& cell = *Get(mouse_over.value());
   cell.highlighted = false;
-  for (auto& neighbor : cell.neighbors) {
-    Get(neighbor).value().highlighted = false;
+  if (cell.covered) return;  // AddHighLight didn't touch them either
+  for (auto& neighbor : Neighbors(mouse_over.value())) {
+    Get(neighbor)->highlighted = false;
   }
 }
 
 void Level::AddHighLight() {
   if (!mouse_over || name == "levelselection") return;
-  auto& cell = Get(mouse_over.value()).value();
+  auto& cell = *Get(mouse_over.value());
   cell.highlighted = true;
   if (cell.covered) return;
   // highlight empty cell's neighbors
-  for (auto& neighbor : cell.neighbors) {
-    Get(neighbor).value().highlighted = true;
+  for (auto& neighbor : Neighbors(mouse_over.value())) {
+    Get(neighbor)->highlighted = true;
   }
 }
 
 void Level::UpdateMouseOver() {
+  PROFILE_ZONE("Level::UpdateMouseOver");
   // tiles' visual edge distance from the rect
   static constexpr float margin = 0.025f;
   mouse_over_last_frame = mouse_over;
@@ -480,12 +852,13 @@ void Level::UpdateMouseOver() {
   }
 
   // lazy update
-  if (!camera_moved && GetMouseDelta() == rl::Vector2{0.0f, 0.0f}) return;
+  if (!camera_moved && Input::GetMouseDelta() == rl::Vector2{0.0f, 0.0f})
+    return;
 
   mouse_over = {};
 
   rl::Vector2 mouse_pos = CoordTransform::PixelToWorld(
-      (rl::Vector2)GetMousePosition() * ssaa_scale);
+      (rl::Vector2)Input::GetMousePosition() * ssaa_scale);
   for (auto& board_info : board_rect_cache) {
     auto& board = boards[board_info.index];
     auto& rect = board_info.rect;
@@ -503,6 +876,14 @@ void Level::UpdateMouseOver() {
 }
 
 void Level::HandleMouseInput() {
+  PROFILE_ZONE("Level::HandleMouseInput");
+  // pressing and releasing changes how tiles look, even without a move
+  for (auto button :
+       {MOUSE_BUTTON_LEFT, MOUSE_BUTTON_MIDDLE, MOUSE_BUTTON_RIGHT})
+    if (Input::IsMouseButtonPressed(button) ||
+        Input::IsMouseButtonReleased(button))
+      damaged = true;
+
   if (state != State::gaming) return;
   if (name == "menu") return;
 
@@ -510,10 +891,10 @@ void Level::HandleMouseInput() {
   static constexpr float mouse_move_invalidate_dist = 0.0125f;
   static rl::Vector2 mouse_dist_since_click = {0, 0};
 
-  if (IsMouseButtonDown(MOUSE_BUTTON_LEFT) ||
-      IsMouseButtonDown(MOUSE_BUTTON_MIDDLE) ||
-      IsMouseButtonDown(MOUSE_BUTTON_RIGHT)) {
-    mouse_dist_since_click += (rl::Vector2)GetMouseDelta() / window_size.x;
+  if (Input::IsMouseButtonDown(MOUSE_BUTTON_LEFT) ||
+      Input::IsMouseButtonDown(MOUSE_BUTTON_MIDDLE) ||
+      Input::IsMouseButtonDown(MOUSE_BUTTON_RIGHT)) {
+    mouse_dist_since_click += Input::GetMouseDelta() / window_size.x;
   } else {
     mouse_dist_since_click = 0;
   }
@@ -523,74 +904,205 @@ void Level::HandleMouseInput() {
   // pop the click up if tile changed or mouse moved too far
   if (mouse_over_last_frame != mouse_over || moved_too_far) {
     if (mouse_over_last_frame) {
-      auto& cell = Get(mouse_over_last_frame.value()).value();
+      auto& cell = *Get(mouse_over_last_frame.value());
 
+      // only a chord presses neighbors, don't work them out just for this
+      if (cell.chord) {
+        for (auto& neighbor : Neighbors(mouse_over_last_frame.value())) {
+          Get(neighbor)->pressed = false;
+        }
+      }
       cell.pressed = false;
       cell.chord = false;
-      for (auto& neighbor : cell.neighbors) {
-        Get(neighbor).value().pressed = false;
-      }
     }
   }
 
   if (!mouse_over) return;
-  auto& cell = Get(mouse_over.value()).value();
+  auto& cell = *Get(mouse_over.value());
 
   if (name == "levelselection") {
     if (cell.covered || cell.number == 0) return;
     // uncover down
-    if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) cell.pressed = true;
+    if (Input::IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) cell.pressed = true;
 
     // uncover up
-    if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT) && cell.pressed) {
-      Serializer::Load(std::to_string(cell.number), *this);
+    if (Input::IsMouseButtonReleased(MOUSE_BUTTON_LEFT) && cell.pressed) {
+      requested_load = std::to_string(cell.number);
     }
     return;
   }
 
   if (!cell.flagged) {
     // uncover down
-    if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) cell.pressed = true;
+    if (Input::IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) cell.pressed = true;
 
     // uncover up
-    if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT) && cell.pressed) Open(cell);
+    if (Input::IsMouseButtonReleased(MOUSE_BUTTON_LEFT) && cell.pressed)
+      Apply({MoveType::open, mouse_over.value()});
 
     // chording down
-    if (!cell.covered && ((IsMouseButtonDown(MOUSE_BUTTON_LEFT) &&
-                           IsMouseButtonPressed(MOUSE_BUTTON_RIGHT)) ||
-                          (IsMouseButtonDown(MOUSE_BUTTON_RIGHT) &&
-                           IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) ||
-                          IsMouseButtonPressed(MOUSE_BUTTON_MIDDLE))) {
+    if (!cell.covered && ((Input::IsMouseButtonDown(MOUSE_BUTTON_LEFT) &&
+                           Input::IsMouseButtonPressed(MOUSE_BUTTON_RIGHT)) ||
+                          (Input::IsMouseButtonDown(MOUSE_BUTTON_RIGHT) &&
+                           Input::IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) ||
+                          Input::IsMouseButtonPressed(MOUSE_BUTTON_MIDDLE))) {
       cell.chord = true;
-      for (auto& neighbor : cell.neighbors) {
-        if (!Get(neighbor).value().flagged)
-          Get(neighbor).value().pressed = true;
+      for (auto& neighbor : Neighbors(mouse_over.value())) {
+        if (!Get(neighbor)->flagged)
+          Get(neighbor)->pressed = true;
       }
     }
 
     // chording up
-    if (cell.chord && IsMouseButtonUp(MOUSE_BUTTON_LEFT) &&
-        IsMouseButtonUp(MOUSE_BUTTON_MIDDLE) &&
-        IsMouseButtonUp(MOUSE_BUTTON_RIGHT)) {
+    if (cell.chord && Input::IsMouseButtonUp(MOUSE_BUTTON_LEFT) &&
+        Input::IsMouseButtonUp(MOUSE_BUTTON_MIDDLE) &&
+        Input::IsMouseButtonUp(MOUSE_BUTTON_RIGHT)) {
       cell.chord = false;
-      for (auto& neighbor : cell.neighbors) {
-        Get(neighbor).value().pressed = false;
+      for (auto& neighbor : Neighbors(mouse_over.value())) {
+        Get(neighbor)->pressed = false;
       }
-      Chord(cell);
+      Apply({MoveType::chord, mouse_over.value()});
     }
   }
 
   // right-click changing marks
-  if (IsMouseButtonPressed(MOUSE_BUTTON_RIGHT)) {
-    auto& cell = Get(mouse_over.value()).value();
+  if (Input::IsMouseButtonPressed(MOUSE_BUTTON_RIGHT)) {
+    auto& cell = *Get(mouse_over.value());
     if (cell.pressed)
       cell.pressed = false;
     else if (cell.covered)
+      Apply({MoveType::mark, mouse_over.value()});
+  }
+}
+
+void Level::Apply(Move move) {
+  // Open relies on mouse_over for the first-click mine relocation, which
+  // isn't where the mouse is when replaying a journal
+  auto mouse_over_prev = mouse_over;
+  mouse_over = move.id;
+
+  history.resize(history_at);
+  auto& delta = history.emplace_back();
+  delta.mine_left[0] = mine_left;
+  delta.state[0] = state;
+  delta.started[0] = started;
+  uncovered_scratch.clear();
+
+  switch (move.type) {
+    case MoveType::open: Open(move.id); break;
+    case MoveType::chord: Chord(move.id); break;
+    case MoveType::mark: {
+      auto& cell = *Get(move.id);
+      MoveDelta::Mark mark = {move.id, {cell.flagged}, {cell.question_mark}};
       CycleMarking(cell);
+      mark.flagged[1] = cell.flagged;
+      mark.question_mark[1] = cell.question_mark;
+      delta.marks.push_back(mark);
+      break;
+    }
+  }
+
+  // row-major on each board, so a flood turns into a few long runs
+  std::sort(uncovered_scratch.begin(),
+            uncovered_scratch.end(),
+            [&](const CellID& a, const CellID& b) {
+              if (a.board_index != b.board_index)
+                return a.board_index < b.board_index;
+              return a.y != b.y ? a.y < b.y : a.x < b.x;
+            });
+  for (auto& id : uncovered_scratch) {
+    u64 index = (u64)id.y * boards[id.board_index].width + id.x;
+    auto& runs = delta.uncovered;
+    if (!runs.empty() && runs.back().board_index == id.board_index &&
+        runs.back().start + runs.back().length == index)
+      runs.back().length++;
+    else
+      runs.push_back({id.board_index, 1, index});
+  }
+
+  // clicking an open cell or a chord that doesn't add up is no step back
+  if (delta.uncovered.empty() && delta.marks.empty()) history.pop_back();
+  history_at = history.size();
+
+  mouse_over = mouse_over_prev;
+  move.time = time;
+  moves.push_back(move);
+  damaged = true;
+}
+
+template <class F>
+void Level::ForEachUncovered(const MoveDelta& delta, F&& f) {
+  for (auto& run : delta.uncovered) {
+    auto& board = boards[run.board_index];
+    for (u64 i = run.start; i < run.start + run.length; i++) {
+      f(*board.Get(i % board.width, i / board.width));
+    }
+  }
+}
+
+bool Level::Undo() {
+  if (history_at == 0) return false;
+  auto& delta = history[--history_at];
+  delta.mine_left[1] = mine_left;
+  delta.state[1] = state;
+  delta.started[1] = started;
+
+  ForEachUncovered(delta, [](Cell& cell) { cell.covered = true; });
+  for (auto& mark : delta.marks) {
+    auto& cell = *Get(mark.id);
+    cell.flagged = mark.flagged[0];
+    cell.question_mark = mark.question_mark[0];
+  }
+  if (delta.relocated) {
+    auto [from, to] = delta.relocated.value();
+    Get(from)->mine = true;
+    Get(to)->mine = false;
+    CalculateMineNumbers(true);
+    PatchZeroRegions(from, to);
+  }
+
+  mine_left = delta.mine_left[0];
+  state = delta.state[0];
+  started = delta.started[0];
+  winning_check_needed = false;
+  rewound = true;
+  damaged = true;
+  return true;
+}
+
+bool Level::Redo() {
+  if (history_at == history.size()) return false;
+  auto& delta = history[history_at++];
+
+  // numbers were worked out when the cells were first opened, covering them
+  // again left them alone
+  if (delta.relocated) {
+    auto [from, to] = delta.relocated.value();
+    Get(from)->mine = false;
+    Get(to)->mine = true;
   }
+  ForEachUncovered(delta, [](Cell& cell) { cell.covered = false; });
+  if (delta.relocated) {
+    CalculateMineNumbers(true);
+    PatchZeroRegions(delta.relocated->first, delta.relocated->second);
+  }
+  for (auto& mark : delta.marks) {
+    auto& cell = *Get(mark.id);
+    cell.flagged = mark.flagged[1];
+    cell.question_mark = mark.question_mark[1];
+  }
+
+  mine_left = delta.mine_left[1];
+  state = delta.state[1];
+  started = delta.started[1];
+  winning_check_needed = false;
+  rewound = true;
+  damaged = true;
+  return true;
 }
 
-void Level::Open(Cell& cell) {
+void Level::Open(CellID id) {
+  auto& cell = *Get(id);
   if (cell.flagged) return;
   if (!cell.covered) return;  // stop infinite recursing
 
@@ -599,25 +1111,26 @@ void Level::Open(Cell& cell) {
     // board
     // spaghetti code here, checks current cell's ID by using mouse_over because
     // chording doesn't matter for the first click
-    auto& id = mouse_over.value();
-    auto& board = boards[id.board_index];
+    auto& clicked = mouse_over.value();
+    auto& board = boards[clicked.board_index];
     while (true) {
-      i32 x = GetRandomValue(0, board.width - 1);   // both sides inclusive
-      i32 y = GetRandomValue(0, board.height - 1);  // both sides inclusive
-      auto& optional_cell = board.Get(x, y);
+      i32 x = rng.Range(0, board.width - 1);   // both sides inclusive
+      i32 y = rng.Range(0, board.height - 1);  // both sides inclusive
+      auto* optional_cell = board.Get(x, y);
       if (!optional_cell) continue;
-      auto& new_cell = optional_cell.value();
+      auto& new_cell = *optional_cell;
       if (new_cell.mine || !new_cell.covered || new_cell.safe) continue;
       new_cell.mine = true;
       cell.mine = false;
+      history.back().relocated = {id, CellID{x, y, clicked.board_index}};
       CalculateMineNumbers(true);
+      PatchZeroRegions(id, CellID{x, y, clicked.board_index});
       break;
     }
   }
 
-  cell.covered = false;
+  Uncover(id, cell);
   started = true;
-  cell.question_mark = false;
 
   if (cell.mine == true) {
     state = State::lost;
@@ -626,22 +1139,218 @@ void Level::Open(Cell& cell) {
 
   winning_check_needed = true;
 
-  if (cell.number == 0) {
-    for (auto& neighbor : cell.neighbors) {
-      Open(Get(neighbor).value());
+  cell.number = CountMines(id);
+  if (cell.number == 0 && !OpenZeroRegion(id)) {
+    for (auto& neighbor : Neighbors(id)) {
+      Open(neighbor);
+    }
+  }
+}
+
+void Level::Uncover(CellID id, Cell& cell) {
+  // only ever inside Apply, history.back() is the move being applied
+  if (cell.question_mark)
+    history.back().marks.push_back({id, {false, false}, {true, false}});
+  uncovered_scratch.push_back(id);
+  cell.covered = false;
+  cell.question_mark = false;
+}
+
+u32 Level::CellIndex(CellID id) {
+  static constexpr u32 mask = ChunkedCells::tile_size - 1;
+  auto& board = boards[id.board_index];
+  auto& index = zero_regions.boards[id.board_index];
+  if (!board.Chunked()) return index.dense[id.y * board.width + id.x];
+  u32 tiles_x = std::get<ChunkedCells>(board.cells).tiles_x;
+  u32 tile = (id.y >> ChunkedCells::tile_bits) * tiles_x +
+             (id.x >> ChunkedCells::tile_bits);
+  return (*index.tiles[tile])[ChunkedCells::Morton(id.x & mask, id.y & mask)];
+}
+
+CellID Level::CellAt(u32 index) {
+  auto& spans = zero_regions.spans;
+  auto& span = *(std::upper_bound(spans.begin(),
+                                  spans.end(),
+                                  index,
+                                  [](u32 index, const ZeroRegions::Span& span) {
+                                    return index < span.first;
+                                  }) -
+                 1);
+  u32 slot = zero_regions.slots[index];
+  auto& board = boards[span.board_index];
+  if (!board.Chunked()) {
+    return CellID{
+        (i32)(slot % board.width), (i32)(slot / board.width), span.board_index};
+  }
+  u32 tiles_x = std::get<ChunkedCells>(board.cells).tiles_x;
+  u32 x = (span.tile % tiles_x) << ChunkedCells::tile_bits |
+          ChunkedCells::Compact(slot);
+  u32 y = (span.tile / tiles_x) << ChunkedCells::tile_bits |
+          ChunkedCells::Compact(slot >> 1);
+  return CellID{(i32)x, (i32)y, span.board_index};
+}
+
+bool Level::IsZero(CellID id) {
+  if (Get(id)->mine) return false;
+  for (auto& neighbor : FindNeighbors(id)) {
+    if (Get(neighbor)->mine) return false;
+  }
+  return true;
+}
+
+void Level::BuildZeroRegions() {
+  PROFILE_ZONE("Level::BuildZeroRegions");
+  // a slot is a place in a dense board's cells or a tile's
+  static_assert(max_dense_cells <= 1 << 16);
+  auto& regions = zero_regions;
+  regions = {};
+  u64 cells = 0;
+  for (auto& board : boards)
+    board.ForEachCell([&](i32, i32, Cell&) { cells++; });
+  if (cells >= ZeroRegions::none) return;
+
+  regions.boards.resize(boards.size());
+  regions.slots.reserve(cells);
+  // indices in storage order, one span per dense board or tile
+  auto number = [&](u32 board_index, u32 tile, auto& storage, auto indices) {
+    regions.spans.push_back({(u32)regions.slots.size(), board_index, tile});
+    for (size_t i = 0; i < storage.size(); i++) {
+      if (!storage[i]) continue;
+      indices[i] = regions.slots.size();
+      regions.slots.push_back(i);
+    }
+  };
+  for (u32 b = 0; b < boards.size(); b++) {
+    auto& index = regions.boards[b];
+    if (auto* dense = std::get_if<DenseCells>(&boards[b].cells)) {
+      index.dense.assign(dense->cells.size(), ZeroRegions::none);
+      number(b, 0, dense->cells, index.dense.begin());
+      continue;
+    }
+    auto& directory = std::get<ChunkedCells>(boards[b].cells).directory;
+    index.tiles.resize(directory.size());
+    for (u32 t = 0; t < directory.size(); t++) {
+      if (!directory[t]) continue;
+      index.tiles[t] = std::make_unique<ZeroRegions::Tile>();
+      index.tiles[t]->fill(ZeroRegions::none);
+      number(b, t, *directory[t], index.tiles[t]->begin());
+    }
+  }
+
+  regions.parent.resize(cells);
+  regions.next.assign(cells, ZeroRegions::none);
+  for (u32 i = 0; i < cells; i++) regions.parent[i] = i;
+
+  for (u32 b = 0; b < boards.size(); b++) {
+    boards[b].ForEachCell([&](i32 x, i32 y, Cell&) {
+      auto id = CellID{x, y, b};
+      u32 index = CellIndex(id);
+      if (IsZero(id)) regions.next[index] = index;
+    });
+  }
+  // zero cells next to each other, on the same board or through a portal,
+  // are one region
+  for (u32 b = 0; b < boards.size(); b++) {
+    boards[b].ForEachCell([&](i32 x, i32 y, Cell&) {
+      auto id = CellID{x, y, b};
+      u32 index = CellIndex(id);
+      if (regions.next[index] == ZeroRegions::none) return;
+      for (auto& neighbor : FindNeighbors(id)) {
+        u32 other = CellIndex(neighbor);
+        if (regions.next[other] != ZeroRegions::none)
+          regions.Union(index, other);
+      }
+    });
+  }
+  regions.built = true;
+}
+
+void Level::PatchZeroRegions(CellID from, CellID to) {
+  if (!zero_regions.built) return;
+  auto& regions = zero_regions;
+  // only the two cells and their neighbors can change between zero and not.
+  // Every region one of them is in is taken apart, since it may have split,
+  // and its cells are joined again like BuildZeroRegions does
+  auto& cells = region_scratch;
+  cells.clear();
+  auto take_apart = [&](CellID id) {
+    u32 start = CellIndex(id);
+    if (regions.next[start] == ZeroRegions::none) {
+      cells.push_back(start);
+      return;
+    }
+    u32 i = start;
+    do {
+      u32 next = regions.next[i];
+      regions.next[i] = ZeroRegions::none;
+      regions.parent[i] = i;
+      cells.push_back(i);
+      i = next;
+    } while (i != start);
+  };
+  for (auto id : {from, to}) {
+    take_apart(id);
+    for (auto& neighbor : FindNeighbors(id)) take_apart(neighbor);
+  }
+
+  for (u32 index : cells) {
+    if (regions.next[index] == ZeroRegions::none && IsZero(CellAt(index)))
+      regions.next[index] = index;
+  }
+  for (u32 index : cells) {
+    if (regions.next[index] == ZeroRegions::none) continue;
+    for (auto& neighbor : FindNeighbors(CellAt(index))) {
+      u32 other = CellIndex(neighbor);
+      if (regions.next[other] != ZeroRegions::none)
+        regions.Union(index, other);
     }
   }
 }
 
-void Level::Chord(Cell& cell) {
+bool Level::OpenZeroRegion(CellID id) {
+  if (!zero_regions.built) return false;
+  auto& regions = zero_regions;
+  u32 start = CellIndex(id);
+  if (regions.next[start] == ZeroRegions::none) return false;
+
+  // a flood stops at flags and open cells, this one only goes ahead when
+  // there's nothing to stop it. Otherwise the same cells come out
+  for (u32 i = regions.next[start]; i != start; i = regions.next[i]) {
+    auto& cell = *Get(CellAt(i));
+    if (cell.flagged || !cell.covered) return false;
+  }
+
+  u32 i = start;
+  do {
+    auto member = CellAt(i);
+    auto& cell = *Get(member);
+    if (cell.covered) {
+      Uncover(member, cell);
+      cell.number = 0;
+    }
+    // the numbers around it, no zero cell has a mine next to it
+    for (auto& neighbor : Neighbors(member)) {
+      if (regions.next[CellIndex(neighbor)] != ZeroRegions::none) continue;
+      auto& number = *Get(neighbor);
+      if (number.flagged || !number.covered) continue;
+      Uncover(neighbor, number);
+      number.number = CountMines(neighbor);
+    }
+    i = regions.next[i];
+  } while (i != start);
+  return true;
+}
+
+void Level::Chord(CellID id) {
+  auto& cell = *Get(id);
   // no more to flag -> open all
   u32 flags = 0;
-  for (auto& neighbor : cell.neighbors) {
-    if (Get(neighbor).value().flagged) flags++;
+  for (auto& neighbor : Neighbors(id)) {
+    if (Get(neighbor)->flagged) flags++;
   }
   if (cell.number == flags) {
-    for (auto& neighbor : cell.neighbors) {
-      Open(Get(neighbor).value());
+    for (auto& neighbor : Neighbors(id)) {
+      Open(neighbor);
     }
     return;
   }
@@ -650,11 +1359,11 @@ void Level::Chord(Cell& cell) {
   // commented out because this is too op
   // u32 cover = 0;
   // for (auto& neighbor : cell.neighbors) {
-  //   if (Get(neighbor).value().covered) cover++;
+  //   if (Get(neighbor)->covered) cover++;
   // }
   // if (cover == cell.number) {
   //   for (auto& neighbor : cell.neighbors) {
-  //     auto& cell = Get(neighbor).value();
+  //     auto& cell = *Get(neighbor);
   //     if (cell.covered) {
   //       cell.question_mark = false;
   //       cell.flagged = true;
@@ -680,40 +1389,38 @@ void Level::CycleMarking(Cell& cell) {
 void Level::CheckGameWon() {
   winning_check_needed = false;
   for (auto& board : boards) {
-    for (i32 x = 0; x < board.width; x++) {
-      for (i32 y = 0; y < board.height; y++) {
-        if (!board.Get(x, y)) continue;
-        auto& cell = board.Get(x, y).value();
-        if (cell.covered && !cell.mine) return;
-      }
-    }
+    bool done = true;
+    board.ForEachCell([&](i32, i32, Cell& cell) {
+      if (cell.covered && !cell.mine) done = false;
+    });
+    if (!done) return;
   }
   mine_left = 0;
   state = State::won;
 }
 
 // ---------------- Drawing functions ---------------
-void Cell::Draw(rl::Rect world_coord, State state, AtlasManager& atlas) {
+void Cell::Draw(rl::Rect world_coord, State state, DrawList& list) {
   rl::Rect coord = CoordTransform::WorldToPixel(world_coord);
   if (!covered) {
     if (mine)
-      atlas.Draw(Tile::detonated, coord);
+      list.Draw(Tile::detonated, coord);
     else
-      atlas.Draw(number, coord);
+      list.Draw(number, coord);
   } else {  // covered
     if (flagged) {
       if (state == State::lost) {
         if (mine)
-          atlas.Draw(Tile::mine, coord);
+          list.Draw(Tile::mine, coord);
         else
-          atlas.Draw(Tile::no_mine, coord);
+          list.Draw(Tile::no_mine, coord);
         return;
       }
     } else if (state == State::lost && mine) {
-      atlas.Draw(Tile::mine, coord);
+      list.Draw(Tile::mine, coord);
       return;
     } else if (state == State::won && mine) {
-      atlas.Draw(Tile::flagged, coord);
+      list.Draw(Tile::flagged, coord);
       return;
     }
 
@@ -723,38 +1430,62 @@ void Cell::Draw(rl::Rect world_coord, State state, AtlasManager& atlas) {
 
     if (highlighted) {
       if (pressed)
-        atlas.Draw((Tile)((int)Tile::covered_highlight_press + offset), coord);
+        list.Draw((Tile)((int)Tile::covered_highlight_press + offset), coord);
       else
-        atlas.Draw((Tile)((int)Tile::covered_highlight + offset), coord);
+        list.Draw((Tile)((int)Tile::covered_highlight + offset), coord);
     } else {
       if (pressed)
-        atlas.Draw((Tile)((int)Tile::covered_press + offset), coord);
+        list.Draw((Tile)((int)Tile::covered_press + offset), coord);
       else
-        atlas.Draw((Tile)((int)Tile::covered + offset), coord);
+        list.Draw((Tile)((int)Tile::covered + offset), coord);
     }
   }
 }
 
-void Board::Draw(rl::Rect rect, State state, AtlasManager& atlas) {
+void Board::Draw(rl::Rect rect, State state, DrawList& list) {
   auto pixel_rect = CoordTransform::WorldToPixel(rect);
   if (pixel_rect.width * pixel_rect.height < 2.0f) return;
   if (!rect.CheckCollision(camera_world_rect)) return;
-  for (i32 x = 0; x < width; x++) {
-    for (i32 y = 0; y < height; y++) {
-      auto element = Get(x, y);
-      if (!element) continue;
-      auto cell_rect = GetCellRect(Vec2i{x, y}, rect);
-      element.value().Draw(cell_rect, state, atlas);
-    }
-  }
+  // only what's on screen, zoomed in on a huge board that's a tiny part of it
+  ForEachCell(camera_world_rect, rect, [&](i32 x, i32 y, Cell& cell) {
+    cell.Draw(GetCellRect(Vec2i{x, y}, rect), state, list);
+  });
+}
+
+Level::PixelView Level::CurrentPixelView() {
+  double scale = (double)camera_zoom * canvas_size.x;
+  return {scale,
+          0.5 * canvas_size.x - camera_coord.x * scale,
+          0.5 * inverse_aspect_ratio * canvas_size.x - camera_coord.y * scale};
+}
+
+rl::Rect Level::PixelView::ToPixel(rl::Rect world) const {
+  return rl::Rect((float)(world.x * scale + x),
+                  (float)(world.y * scale + y),
+                  (float)(world.width * scale),
+                  (float)(world.height * scale));
 }
 
-void Level::Draw(AtlasManager& atlas) {
+void Level::Draw(DrawList& list) {
+  PROFILE_ZONE("Level::Draw");
   for (auto& info : board_rect_cache) {
-    boards[info.index].Draw(info.rect, state, atlas);
+    if (info.feedback) {
+      // where the source was on the canvas the window captured last, and
+      // where it ends up for the frames replaying this list again
+      auto& source = board_rect_cache[info.feedback.value()];
+      list.DrawFeedback(drawn_view->ToPixel(source.rect),
+                        CoordTransform::WorldToPixel(source.rect),
+                        CoordTransform::WorldToPixel(info.rect));
+    } else {
+      boards[info.index].Draw(info.rect, state, list);
+    }
   }
+  drawn_view = CurrentPixelView();
+
+  // one zone for all of them, per call would flood the trace
+  PROFILE_ZONE("Level::DrawCloneHint");
   for (auto& info : board_rect_cache) {
-    DrawCloneHint(info);
+    DrawCloneHint(info, list);
   }
 }
 
@@ -766,8 +1497,10 @@ float smoothstep(float num, float edge0, float edge1) {
 }
 
 // drawing a square shouldn't be this complex, yet here we are...
-void Level::DrawCloneHint(BoardRectInfo info) {
+void Level::DrawCloneHint(BoardRectInfo info, DrawList& list) {
   if (!boards[info.index].has_clones) return;
+  // already in the copied pixels
+  if (info.feedback) return;
 
   static const rl::Color blue = {0x59e2ff00};
   static const rl::Color yellow = {0xff9a0000};
@@ -825,5 +1558,5 @@ void Level::DrawCloneHint(BoardRectInfo info) {
 
   line_width *= 1.75f;
 
-  pixel_rect.DrawRoundedLines(roundness, 12, line_width, color);
+  list.DrawRoundedLines(pixel_rect, roundness, 12, line_width, color);
 }
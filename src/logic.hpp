@@ -1,11 +1,22 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <memory_resource>
 #include <optional>
+#include <span>
+#include <string_view>
 #include <utility>
+#include <variant>
 #include <vector>
 
-#include "atlas.hpp"
+#include "arena.hpp"
+#include "draw_list.hpp"
+#include "endless.hpp"
 #include "fixed_size_int.hpp"
+#include "random.hpp"
+#include "rational.hpp"
 #include "rl.hpp"
 #include "serializer.hpp"
 #include "vec2i.hpp"
@@ -35,6 +46,47 @@ struct CellID {
   };
 };
 
+enum class MoveType : u8 {
+  open,
+  chord,
+  mark,
+};
+
+// everything the player can do to a level, replayable from the seed
+struct Move {
+  MoveType type;
+  CellID id;
+  float time = 0;  // level time it was applied at, Apply sets it
+};
+
+// cells start to start + length, row-major on one board. A huge chunked
+// board has more cells than a u32 counts
+struct CellRun {
+  u32 board_index;
+  u32 length;
+  u64 start;
+};
+
+// what one move changed, so undo and redo never run it again. A flood reveal
+// is a few runs per board instead of a copy of it
+struct MoveDelta {
+  // cells whose marks changed, [0] before the move and [1] after
+  struct Mark {
+    CellID id;
+    bool flagged[2];
+    bool question_mark[2];
+  };
+
+  vector<CellRun> uncovered;
+  vector<Mark> marks;
+  // the first click's mine, moved from the first cell to the second
+  optional<pair<CellID, CellID>> relocated;
+  // [1] is only known once the move is undone, the win check runs later
+  i32 mine_left[2];
+  State state[2];
+  bool started[2];
+};
+
 struct Portal {
   i32 x;
   i32 y;
@@ -59,27 +111,168 @@ struct Cell {
   bool highlighted = false;
   bool pressed = false;
   bool chord = false;
-  vector<CellID> neighbors;
-  void Draw(rl::Rect world_coord, State state, AtlasManager& atlas);
+  // lives in the level's arena, keeps cells trivially destructible so
+  // unloading a level doesn't walk every cell. Only filled in the first time
+  // Level::Neighbors asks for it
+  std::span<CellID> neighbors;
+  bool neighbors_known = false;
+  void Draw(rl::Rect world_coord, State state, DrawList& list);
+
+  // the state that outlives a frame in one byte, for saving. Never 0, that's
+  // left for void cells. Unpack leaves number at 0
+  u8 Pack() const;
+  static optional<Cell> Unpack(u8 bits);
 };
 
-struct Board {
-  u32 width;
-  u32 height;
+// Cell storage policies. Both hand cells to ForEach(x0, y0, x1, y1, f) as
+// f(x, y, cell), void cells are skipped and the range is end exclusive
+
+// row-major, what every handmade board uses
+struct DenseCells {
+  u32 width = 0;
   vector<optional<Cell>> cells;
+
+  inline optional<Cell>* Find(u32 x, u32 y) { return &cells[y * width + x]; }
+  inline optional<Cell>& Create(u32 x, u32 y) { return cells[y * width + x]; }
+
+  template <class F>
+  void ForEach(u32 x0, u32 y0, u32 x1, u32 y1, F&& f) {
+    for (u32 y = y0; y < y1; y++) {
+      for (u32 x = x0; x < x1; x++) {
+        auto& optional_cell = cells[y * width + x];
+        if (optional_cell) f((i32)x, (i32)y, optional_cell.value());
+      }
+    }
+  }
+};
+
+// for huge, mostly void boards. 64x64 tiles only exist where cells do, and
+// are Z-ordered inside so a cell's vertical neighbors are nearby in memory too
+struct ChunkedCells {
+  static constexpr u32 tile_bits = 6;
+  static constexpr u32 tile_size = 1 << tile_bits;
+  using Tile = std::array<optional<Cell>, tile_size * tile_size>;
+
+  u32 tiles_x = 0;
+  u32 tiles_y = 0;
+  vector<std::unique_ptr<Tile>> directory;  // row-major, null when all void
+
+  // bits of x on even positions, y on odd ones
+  static inline u32 Morton(u32 x, u32 y) {
+    return Spread(x) | (Spread(y) << 1);
+  }
+  static inline u32 Spread(u32 v) {
+    v = (v | (v << 4)) & 0x0f0f;
+    v = (v | (v << 2)) & 0x3333;
+    v = (v | (v << 1)) & 0x5555;
+    return v;
+  }
+  static inline u32 Compact(u32 v) {
+    v &= 0x5555;
+    v = (v | (v >> 1)) & 0x3333;
+    v = (v | (v >> 2)) & 0x0f0f;
+    v = (v | (v >> 4)) & 0x00ff;
+    return v;
+  }
+
+  optional<Cell>* Find(u32 x, u32 y);    // nullptr when the tile is void
+  optional<Cell>& Create(u32 x, u32 y);  // allocates the tile if needed
+
+  template <class F>
+  void ForEach(u32 x0, u32 y0, u32 x1, u32 y1, F&& f) {
+    if (x0 >= x1 || y0 >= y1) return;
+    for (u32 ty = y0 >> tile_bits; ty <= (y1 - 1) >> tile_bits; ty++) {
+      u32 tile_y = ty << tile_bits;
+      // the clip in tile coordinates, so a small one walks only its cells
+      u32 ly0 = std::max(y0, tile_y) - tile_y;
+      u32 ly1 = std::min(y1 - tile_y, tile_size);
+      for (u32 tx = x0 >> tile_bits; tx <= (x1 - 1) >> tile_bits; tx++) {
+        auto& tile = directory[ty * tiles_x + tx];
+        if (!tile) continue;
+        u32 tile_x = tx << tile_bits;
+        u32 lx0 = std::max(x0, tile_x) - tile_x;
+        u32 lx1 = std::min(x1 - tile_x, tile_size);
+        for (u32 ly = ly0; ly < ly1; ly++) {
+          u32 row = Spread(ly) << 1;
+          for (u32 lx = lx0; lx < lx1; lx++) {
+            auto& optional_cell = (*tile)[row | Spread(lx)];
+            if (!optional_cell) continue;
+            f((i32)(tile_x + lx), (i32)(tile_y + ly), optional_cell.value());
+          }
+        }
+      }
+    }
+  }
+};
+
+struct Board {
+  u32 width = 0;
+  u32 height = 0;
+  std::variant<DenseCells, ChunkedCells> cells;
   bool has_clones = false;
 
+  Board() = default;
+  // all void. Picks the storage policy from the size
+  Board(u32 width, u32 height);
+
   bool Inside(Vec2i pos);
   rl::Rect GetCellRect(Vec2i pos, rl::Rect board_rect);
-  optional<Cell>& Get(Vec2i pos);     // checked
-  optional<Cell>& Get(i32 x, i32 y);  // checked
-  void Draw(rl::Rect rect, State state, AtlasManager& atlas);
+  // checked, nullptr for void cells and outside the board
+  Cell* Get(Vec2i pos);
+  Cell* Get(i32 x, i32 y);
+  void Set(i32 x, i32 y, optional<Cell> cell);  // checked
+  bool Chunked() const;
+  // heap held by the cell storage, void cells included
+  u64 StorageBytes() const;
+  void Draw(rl::Rect rect, State state, DrawList& list);
+
+  // f(x, y, cell) for every non-void cell
+  template <class F>
+  void ForEachCell(F&& f) {
+    ForEachCellIn(0, 0, width, height, f);
+  }
+
+  // same, but only cells that could touch clip. Both rects in world space
+  template <class F>
+  void ForEachCell(rl::Rect clip, rl::Rect board_rect, F&& f) {
+    float cell_width = board_rect.width / width;
+    float cell_height = board_rect.height / height;
+    float left = (clip.x - board_rect.x) / cell_width;
+    float top = (clip.y - board_rect.y) / cell_height;
+    float right = left + clip.width / cell_width;
+    float bottom = top + clip.height / cell_height;
+    // a cell of margin around it, the caller does the exact test
+    auto to_cell = [](float v, u32 max) {
+      return (u32)std::clamp(v, 0.0f, (float)max);
+    };
+    ForEachCellIn(to_cell(left - 1, width),
+                  to_cell(top - 1, height),
+                  to_cell(right + 2, width),
+                  to_cell(bottom + 2, height),
+                  f);
+  }
+
+  template <class F>
+  void ForEachCellIn(u32 x0, u32 y0, u32 x1, u32 y1, F&& f) {
+    std::visit([&](auto& storage) { storage.ForEach(x0, y0, x1, y1, f); },
+               cells);
+  }
 };
 
 struct BoardRectInfo {
   u32 index;
   rl::Rect rect;
   bool clone = false;
+  // in board_rect_cache, what it was unrolled from and for portal cycles, an
+  // instance of the same board to show last frame's pixels of instead
+  u32 parent = 0;
+  optional<u32> feedback;
+};
+
+// BoardRectInfo without the float error, in cells of the board it's seen from
+struct ExactBoardRect {
+  u32 index;
+  RationalRect rect;
 };
 
 // saves data about how to arrive at current rect. stops backtracking
@@ -87,28 +280,158 @@ struct PortalRecord {
   optional<Portal*> portal;
   bool go_up;
   u32 depth;
-  BoardRectInfo board_info;
+  ExactBoardRect board_info;
 
   bool RejectRoute(Portal& portal, bool go_up);
 };
 
+// connected zero cells, portals included, so opening one uncovers all of them
+// and the numbers around them at once instead of flooding cell by cell.
+// Union-find over the level's cells, each region's zero cells are also
+// chained into a circular list to walk them. Only cells that exist get an
+// index, so a huge mostly void board costs what its tiles do
+struct ZeroRegions {
+  static constexpr u32 none = ~0u;
+  using Tile =
+      std::array<u32, ChunkedCells::tile_size * ChunkedCells::tile_size>;
+  // a board's indices laid out like its cells, row-major for a dense board
+  // and Z-ordered tiles for a chunked one, null where the tile is void.
+  // Void cells are none
+  struct BoardIndex {
+    vector<u32> dense;
+    vector<std::unique_ptr<Tile>> tiles;
+  };
+  // the indices from first on are one dense board's or one tile's cells, in
+  // the order they're stored
+  struct Span {
+    u32 first;
+    u32 board_index;
+    u32 tile;  // in the board's directory, 0 on a dense board
+  };
+  vector<BoardIndex> boards;
+  vector<Span> spans;
+  vector<u16> slots;  // per index, where in its span's storage the cell is
+  vector<u32> parent;
+  vector<u32> next;  // the next zero cell of the region, none if not zero
+  bool built = false;
+
+  inline u32 Find(u32 cell) {
+    while (parent[cell] != cell) {
+      parent[cell] = parent[parent[cell]];  // halving, keeps trees flat
+      cell = parent[cell];
+    }
+    return cell;
+  };
+  inline void Union(u32 a, u32 b) {
+    u32 root_a = Find(a);
+    u32 root_b = Find(b);
+    if (root_a == root_b) return;
+    parent[root_b] = root_a;
+    std::swap(next[a], next[b]);  // splices the two circles into one
+  };
+};
+
+// where a level's memory goes, capacities rather than sizes since that's
+// what's actually held
+struct LevelMemory {
+  std::string name;
+  vector<u64> board_bytes;  // cell storage of each board
+  u64 cell_bytes = 0;       // of all boards together
+  u32 chunked_boards = 0;
+  u32 tiles = 0;            // allocated by chunked boards
+  u64 neighbor_bytes = 0;   // lists handed out by the level arena
+  u64 neighbor_slack = 0;   // arena blocks not handed out yet
+  u64 route_bytes = 0;      // memoized neighbor routes and scratch
+  u64 zero_region_bytes = 0;  // the reveal index, built at load
+  u32 portals = 0;
+  u32 clone_portals = 0;
+  u32 rect_cache_entries = 0;
+  u64 rect_cache_bytes = 0;
+  u64 endless_bytes = 0;  // progress saved on boards outside the window
+
+  u64 Total() const;
+};
+
+// portal cycles past the first few instances are drawn from last frame's
+// canvas instead of unrolled. F2 toggles it
+extern bool portal_feedback;
+
 namespace Serializer {
-void Load(std::string name, Level& level, int completed_levels);
+void Parse(std::string name,
+           Level& level,
+           int completed_levels,
+           u64 seed,
+           std::optional<std::string_view> text);
+void Activate(Level& level);
+};
+namespace Snapshot {
+bool Write(Level& level);
+bool Read(Level& level);
+};
+struct BenchSample;
+namespace Bench {
+void Zoom(Level& level, u32 levels, u32 frames);
+BenchSample Measure(Level& level, u32 frames);
+bool Render(std::vector<std::string> args);
 };
 
 class Level {
  public:
-  friend void Serializer::Load(std::string name,
-                               Level& level,
-                               int completed_levels);
+  friend void Serializer::Parse(std::string name,
+                                Level& level,
+                                int completed_levels,
+                                u64 seed,
+                                std::optional<std::string_view> text);
+  friend void Serializer::Activate(Level& level);
+  friend bool Snapshot::Write(Level& level);
+  friend bool Snapshot::Read(Level& level);
+  friend void Endless::Build(Level& level, EndlessParams params);
+  friend void Endless::Fill(Level& level);
+  friend bool Endless::Update(Level& level);
+  friend void Bench::Zoom(Level& level, u32 levels, u32 frames);
+  friend BenchSample Bench::Measure(Level& level, u32 frames);
+  friend bool Bench::Render(std::vector<std::string> args);
+  friend class BatchEnv;
   std::string name;
   i32 mine_left;  // could be negative when falsely marked more mines
   State state;
   bool started;
   float time;
+  u64 seed;  // the whole mine layout can be rebuilt from this
+
+  // levels never load themselves, they ask the scene to do it in the
+  // background instead (restart, level selection)
+  optional<std::string> requested_load;
+
+  // moves applied since the scene last journaled them
+  vector<Move> moves;
+  // how many are in the autosave journal after its snapshot, Snapshot keeps
+  // it up to date
+  u32 journaled_moves = 0;
+
+  // an undo or redo happened since the scene last journaled, the journal
+  // can't replay to this
+  bool rewound = false;
+
+  // something on screen changed this tick, reset at the start of every Tick
+  bool damaged = true;
+
+  // for the debug window
+  const Arena& LevelArena() const { return *arena; }
+  const Arena& FrameArena() const { return *frame_arena; }
+  // fills memory in, reusing its vector
+  void MeasureMemory(LevelMemory& memory) const;
 
   void Tick();
-  void Draw(AtlasManager& atlas);
+  void Draw(DrawList& list);
+  void Apply(Move move);
+  // unlimited, in time proportional to the cells the move changed. A new
+  // move drops whatever could be redone
+  bool Undo();
+  bool Redo();
+
+  // how deep the root board is, only in endless mode
+  optional<i64> EndlessDepth();
 
  private:
   optional<CellID> mouse_over;
@@ -119,37 +442,93 @@ class Level {
   vector<BoardRectInfo> board_rect_cache;
 
   u32 root_board;
+  Rng rng;
+  // set when resuming a snapshot, otherwise the camera starts centered
+  optional<pair<rl::Vector2, float>> resume_camera;
+  optional<EndlessState> endless;
 
-  void DrawCloneHint(BoardRectInfo info);
+  void DrawCloneHint(BoardRectInfo info, DrawList& list);
 
-  optional<Cell>& Get(CellID id);
+  Cell* Get(CellID id);  // nullptr for void cells
 
-  // assume scale at 1, UL 0,0
-  vector<pair<Portal&, BoardRectInfo>> GetParentRectInfo(
-      u32 index, bool non_clone_only = false);
-  vector<pair<Portal&, BoardRectInfo>> GetChildRectInfo(u32 index);
+  // neighbor lists. Freed all at once when the boards are replaced or the
+  // level goes away
+  std::unique_ptr<Arena> arena = std::make_unique<Arena>();
+  // scratch that only lives until the next Tick
+  std::unique_ptr<Arena> frame_arena = std::make_unique<Arena>(64 * 1024);
 
-  vector<pair<Portal&, BoardRectInfo>> GetParentRectInfo(
-      BoardRectInfo info, bool non_clone_only = false);
-  vector<pair<Portal&, BoardRectInfo>> GetChildRectInfo(BoardRectInfo info);
+  using RectInfos = std::pmr::vector<pair<Portal&, BoardRectInfo>>;
+  // assume scale at 1, UL 0,0. Allocated from frame_arena
+  RectInfos GetParentRectInfo(u32 index, bool non_clone_only = false);
+  RectInfos GetChildRectInfo(u32 index);
 
-  // moves camera when needed
-  void ChangeRootBoard();
-  bool ChangeRootBoardOnce();
+  RectInfos GetParentRectInfo(BoardRectInfo info, bool non_clone_only = false);
+  RectInfos GetChildRectInfo(BoardRectInfo info);
+
+  // moves camera when needed, returns how many boards the root moved
+  u32 ChangeRootBoard();
+  // a candidate root. Camera coordinates relative to the current root map to
+  // it as x * scale + (x, y)
+  struct RootView {
+    u32 board;
+    double scale = 1;
+    double x = 0;
+    double y = 0;
+  };
+  // moves view one hop, the camera itself stays as it is. Returns how many
+  // boards it went, 0 once view is the right root
+  u32 StepRootBoard(RootView& view);
+  // per portal, how many of its child's cells span one of the parent's.
+  // Filled in by ResetNeighbors
+  vector<double> portal_scales;
+  // per board, the first portal that isn't a clone leading to it. Nothing
+  // for the top board
+  vector<optional<u32>> parent_portals;
 
   void UpdateBoardRectCache();
+  // an instance up the chain info's pixels can be copied from
+  optional<u32> FindFeedbackSource(const BoardRectInfo& info);
+
+  // world to pixels as pixel = world * scale + offset
+  struct PixelView {
+    double scale;
+    double x;
+    double y;
+    rl::Rect ToPixel(rl::Rect world) const;
+  };
+  static PixelView CurrentPixelView();
+  // the camera of the last Draw, which is what the feedback canvas shows.
+  // Kept relative to the current root, so a root change maps it along
+  optional<PixelView> drawn_view;
 
-  void CalculateNeighbors();  // go through each portal at most once, rect clip
-                              // all the cells in the clipping boardrect
-  void CalculateNeighborsRecursionBoardRectUp(
-      BoardRectInfo info,
-      vector<BoardRectInfo>& board_rects,
-      vector<bool>& portal_gone_through);
-  void CalculateNeighborsRecursionBoardRectDown(
-      BoardRectInfo info,
-      vector<BoardRectInfo>& board_rects,
-      vector<bool>& portal_gone_through);
+  // per board, every other board a cell's neighbors can be on and where it
+  // is. Built for every board the first time any cell needs its neighbors
+  vector<vector<ExactBoardRect>> neighbor_routes;
+  // the same rects rounded outward to whole cells. Most routes are nowhere
+  // near a given cell, these turn them away without any Rational math
+  struct RouteBounds {
+    i64 left, top, right, bottom;
+    bool ring_only = false;  // nothing but void behind the inner cells
+  };
+  vector<vector<RouteBounds>> neighbor_route_bounds;
+  bool routes_known = false;
+  vector<CellID> neighbor_scratch;  // FindNeighbors', it isn't reentrant
 
+  // drops everything memoized and builds the zero regions again, call after
+  // replacing the boards
+  void ResetNeighbors();
+  const vector<ExactBoardRect>& NeighborRoutes(u32 board_index);
+  // one board's search, capped, so it can miss boards that do find it
+  void SearchRoutes(u32 board_index, vector<ExactBoardRect>& routes);
+  // computed on first access and kept, same board and across portals
+  std::span<CellID> Neighbors(CellID id);
+  // the same without keeping them, for walks over cells the player never
+  // touched. In neighbor_scratch unless already kept, so only valid until the
+  // next call
+  std::span<CellID> FindNeighbors(CellID id);
+  u32 CountMines(CellID id);
+
+  // uncovered cells only, covered ones get theirs when they're opened
   void CalculateMineNumbers(bool override = false);
 
   void RemoveHighLight();
@@ -159,10 +538,36 @@ class Level {
 
   // recursively opens empty cells' neighbors
   // does not open a flagged cell
-  void Open(Cell& cell);
-  void Chord(Cell& cell);  // when neighbors' marked mine amount matches
+  void Open(CellID id);
+  // covered to uncovered and recorded in the move's delta, number untouched
+  void Uncover(CellID id, Cell& cell);
+  void Chord(CellID id);  // when neighbors' marked mine amount matches
   void CycleMarking(Cell& cell);
 
+  // history[0, history_at) can be undone, the rest redone. Board indices go
+  // stale when the endless window moves, it's cleared then
+  vector<MoveDelta> history;
+  size_t history_at = 0;
+  vector<CellID> uncovered_scratch;  // Open's, compacted into runs by Apply
+  template <class F>
+  void ForEachUncovered(const MoveDelta& delta, F&& f);
+
+  // rebuilt with the neighbors by ResetNeighbors, so at load. Walks every
+  // cell's neighbors with FindNeighbors, none are kept. Not built for a level
+  // with more cells than a u32 indexes, those flood cell by cell
+  ZeroRegions zero_regions;
+  vector<u32> region_scratch;  // PatchZeroRegions'
+  u32 CellIndex(CellID id);
+  CellID CellAt(u32 index);
+  bool IsZero(CellID id);
+  void BuildZeroRegions();
+  // after the first-click mine moved between the two, regions around both
+  // are taken apart and joined again
+  void PatchZeroRegions(CellID from, CellID to);
+  // the rest of id's region and its numbers. false when a flag or an open
+  // cell in it would have stopped a flood, Open floods it then
+  bool OpenZeroRegion(CellID id);
+
   bool winning_check_needed = false;
   void CheckGameWon();
 };  // namespace Level
@@ -3,23 +3,85 @@
 #include <imgui.h>
 
 #include <algorithm>
+#include <future>
 #include <iostream>
+#include <string>
 
+#include "alloc_counter.hpp"
+#include "asset_pack.hpp"
 #include "atlas.hpp"
+#include "bench.hpp"
 #include "icon_tiny.png.h"
 #include "logic.hpp"
+#include "memory_report.hpp"
+#include "profiler.hpp"
 #include "rl.hpp"
 #include "scene.hpp"
 #include "serializer.hpp"
+#include "simulation.hpp"
 #include "ssaa_window.hpp"
+#include "startup.hpp"
 #include "transform.hpp"
 
 static const rl::Color bg = Color{40, 48, 65, 255};
 
-int main() {
+static bool debug_window = false;
+
+// frames that redrew the canvas vs ones that showed the last one again
+static u64 frames_rendered = 0;
+static u64 frames_idle = 0;
+
+// the memory panel was open last frame, the simulation only measures then
+static bool memory_shown = false;
+static const char* memory_path = "memory.json";
+
+static StartupTimeline startup;
+
+// redraws after the level last changed, for portal feedback to fill in
+static constexpr u32 feedback_settle_frames = 8;
+
+#ifdef PROFILER_ENABLED
+static const char* trace_path = "trace.json";
+static constexpr double trace_seconds = 5.0;
+#endif
+
+int main(int argc, char** argv) {
   // c++'s rand library is way overengineered for this
   SetRandomSeed(time(0));
 
+  if (argc > 1 && std::string{argv[1]} == "--bench")
+    return Bench::Run(argc - 2, argv + 2);
+  // the game ticks on a thread of its own unless asked not to, ticking inline
+  // is easier to debug
+  bool threaded = !(argc > 1 && std::string{argv[1]} == "--inline");
+
+  // decoding, parsing and the main menu's geometry don't need a window, they
+  // run on workers while it opens. Only the uploads wait for the GL context.
+  // The pack is missing when the asset_packer target wasn't run, the pngs are
+  // decoded then
+  AssetPack assets{"res/assets.pack"};
+  auto decode = [&assets](std::string name) {
+    return std::async(std::launch::async, [&assets, name] {
+      auto phase = startup.Begin("decode " + name);
+      return PendingTexture::Decode(assets, name);
+    });
+  };
+  auto loading_source = decode("loading");
+  auto tile_source = decode("tile");
+  std::future<PendingTexture> number_sources[] = {decode("number_0"),
+                                                  decode("number_1")};
+  auto ui_source = decode("ui");
+  auto logo_source = decode("logo");
+  auto menu = std::async(std::launch::async, [] {
+    auto phase = startup.Begin("parse main menu");
+    auto level = std::make_unique<Level>();
+    Serializer::Parse("mainmenu", *level, 0, Serializer::NewSeed());
+    return level;
+  });
+
+  // the phases that can't be a scope of their own
+  std::optional<StartupTimeline::Phase> phase;
+  phase.emplace(startup, "window");
   auto window = SSAAWindow{1280, 720, 2.0f, "InfiniSweeper"};
 
   // make the disgusting white flash disappear as soon as possible
@@ -40,12 +102,16 @@ int main() {
     SetWindowSize(width / 3 * 2, height / 3 * 2);
     SetWindowPosition(width / 6, height / 6);
   }
+  phase.reset();
 
-  // loading screen
+  // loading screen, the texture stays with the atlas afterwards
+  AtlasSources sources;
   {
+    auto scope = startup.Begin("loading screen");
     BeginDrawing();
     ClearBackground(BLACK);
-    auto loading = rl::Texture{"res/loading.png"};
+    auto& loading = sources.loading;
+    loading_source.get().Upload(loading);
     int size = std::min(GetScreenWidth(), GetScreenHeight()) / loading.width;
     if (size < 0) size = 1;
     size *= loading.width;
@@ -58,32 +124,117 @@ int main() {
     EndDrawing();
   }
 
-  AtlasManager atlas;
-  Scene scene;
+  // includes waiting for decodes that aren't done yet
+  phase.emplace(startup, "atlas upload");
+  sources.tile = tile_source.get();
+  for (u32 i = 0; i < 2; i++) sources.number[i] = number_sources[i].get();
+  sources.ui = ui_source.get();
+  sources.logo = logo_source.get();
+  AtlasManager atlas{std::move(sources)};
+
+  phase.emplace(startup, "scene");
+  Simulation simulation{
+      Input::Capture(window.GetView()), threaded, menu.get()};
+  phase.emplace(startup, "first frame");
+  u32 quality_cycles = 0;
+  u64 level_version = 0;
+  u32 feedback_settle = 0;
+  u64 feedback_version = 0;  // of the list the feedback canvas was drawn by
 
-  while (!window.ShouldClose() && !quit) {
+  while (!window.ShouldClose()) {
     CheckFullscreen();
     window.CheckResize();
-    CoordTransform::UpdateCamera();
-    scene.Tick(window);
+    // ticks right here, or hands the input to the simulation thread and
+    // carries on with whatever it finished last
+    auto frame = Input::Capture(window.GetView());
+    frame.measure_memory = debug_window && memory_shown;
+    simulation.Submit(frame);
+    auto& snapshot = simulation.Latest();
+    if (snapshot.quit) break;
+    for (; quality_cycles < snapshot.quality_cycles; quality_cycles++)
+      window.CycleQuality();
 
-    // draw
-    window.BeginDrawing();
-    ClearBackground(bg);
-    scene.Draw(atlas);
+    // draw, only when something changed. Otherwise the previous canvas is
+    // presented again
+    static u32 idle_streak = 0;
+    bool changed = snapshot.level_version != level_version ||
+                   window.GetView().resized || frames_rendered == 0;
+    if (changed || feedback_settle > 0) {
+      window.BeginDrawing();
+      ClearBackground(bg);
+      snapshot.level.Replay(atlas,
+                            window.Feedback(),
+                            feedback_version == snapshot.level_version);
+      if (snapshot.level.HasFeedback()) {
+        // portal cycles get one level deeper every frame, keep going until
+        // the rest is too small to see
+        window.CaptureFeedback();
+        feedback_version = snapshot.level_version;
+        feedback_settle =
+            changed ? feedback_settle_frames : feedback_settle - 1;
+      } else {
+        feedback_settle = 0;
+      }
+      level_version = snapshot.level_version;
+      frames_rendered++;
+      idle_streak = 0;
+    } else {
+      frames_idle++;
+      idle_streak++;
+    }
+
+    // nothing changes without input, sleep in EndDrawing until some arrives.
+    // A running game's timer still has to turn over every second
+    bool wait_for_events =
+        idle_streak > 1 && !snapshot.animating && !debug_window;
+    window.WaitForEvents(wait_for_events, snapshot.timer_wake_at);
+
+    // UI, always redrawn since it's cheap and at native resolution
+    window.BeginUI();
+    snapshot.ui.Replay(atlas);
 
     // imgui
     window.BeginImGui();
-#ifndef NDEBUG
-    ImGuiDebugUI();
+#ifdef PROFILER_ENABLED
+    {
+      PROFILE_ZONE("ImGui");
+      ImGuiDebugUI(window, atlas, snapshot, simulation.Threaded());
+    }
 #endif
     window.EndDrawing();
+#ifdef PROFILER_ENABLED
+    // EndDrawing returns after the swap, which waits for vsync, and raylib's
+    // frame cap, which only waits on frames shorter than 1/240s. Each input
+    // frame counts once, on the first frame showing it. A frame that slept
+    // for events would count the sleep, those are idle anyway
+    static u64 last_sampled = 0;
+    if (snapshot.latency.sampled != last_sampled && !wait_for_events) {
+      auto latency = snapshot.latency;
+      PROFILE_LATENCY(latency, presented);
+      Profiler::RecordLatency(latency);
+    }
+    last_sampled = snapshot.latency.sampled;
+#endif
+    PROFILE_FRAME();
+    AllocCounter::FrameMark();
+
+    // up to here is time to the first interactive frame
+    if (phase) {
+      phase.reset();
+      TraceLog(LOG_INFO,
+               "STARTUP: textures from %s",
+               assets.Loaded() ? "res/assets.pack" : "pngs");
+      startup.Report();
+    }
   }
   return 0;
 }
 
-void ImGuiDebugUI() {
-  static bool debug_window = false;
+void ImGuiDebugUI(const SSAAWindow& window,
+                  const AtlasManager& atlas,
+                  const RenderSnapshot& snapshot,
+                  bool threaded) {
+  auto& view = window.GetView();
   if (IsKeyPressed(KEY_GRAVE)) debug_window = !debug_window;
   if (debug_window) {
     DrawFPS(10, 10);
@@ -93,28 +244,94 @@ void ImGuiDebugUI() {
 
     ImGui::Text("Globals:");
     ImGui::Separator();  //------------------------
-    ImGui::Text("Canvas Size: %4.0f × %4.0f", canvas_size.x, canvas_size.y);
-    ImGui::Text("SSAA Scale: %.2f", ssaa_scale);
-    ImGui::Text("Window Size: %4.0f × %4.0f", window_size.x, window_size.y);
-    ImGui::Text("Inverse Aspect Ratio: %.4f", inverse_aspect_ratio);
+    ImGui::Text("Canvas Size: %4.0f × %4.0f",
+                view.canvas_size.x,
+                view.canvas_size.y);
+    ImGui::Text("SSAA Scale: %.3f%s",
+                view.ssaa_scale,
+                view.ssaa_auto ? " (auto)" : "");
+    ImGui::Text("SSAA Target: %4.0f × %4.0f",
+                view.canvas_capacity.x,
+                view.canvas_capacity.y);
+    ImGui::Text("Window Size: %4.0f × %4.0f",
+                view.window_size.x,
+                view.window_size.y);
+    ImGui::Text("Inverse Aspect Ratio: %.4f", view.inverse_aspect_ratio);
+    ImGui::Text("Frames Rendered: %llu Idle: %llu",
+                (unsigned long long)frames_rendered,
+                (unsigned long long)frames_idle);
+    ImGui::Text("Simulation: %s", threaded ? "own thread" : "inline");
+    ImGui::Text("Draw Lists: %zu level %zu UI",
+                snapshot.level.Size(),
+                snapshot.ui.Size());
     ImGui::Separator();  //------------------------
     ImGui::Text("Camera:");
     ImGui::Text("Pos: %.4f × %.4f\nZoom: %.4f",
-                camera_coord.x,
-                camera_coord.y,
-                camera_zoom);
+                snapshot.camera_coord.x,
+                snapshot.camera_coord.y,
+                snapshot.camera_zoom);
     ImGui::Text("Camera World Rect:\nX: %.4f Y: %.4f\nW: %.4f H: %.4f",
-                camera_world_rect.x,
-                camera_world_rect.y,
-                camera_world_rect.width,
-                camera_world_rect.height);
+                snapshot.camera_world_rect.x,
+                snapshot.camera_world_rect.y,
+                snapshot.camera_world_rect.width,
+                snapshot.camera_world_rect.height);
     ImGui::Separator();  //------------------------
-    auto mouse_world =
-        CoordTransform::PixelToWorld(rl::Mouse::GetPosition() * ssaa_scale);
+    auto& mouse_world = snapshot.mouse_world;
     ImGui::Text("Mouse World Pos:\n %.4f × %.4f", mouse_world.x, mouse_world.y);
     ImGui::Text("Scroll Wheel: %.2f", GetMouseWheelMove());
+    ImGui::Separator();  //------------------------
+    // served is what the level asked for, heap is what that cost
+    auto& level_arena = snapshot.level_arena;
+    auto& frame_arena = snapshot.frame_arena;
+    ImGui::Text("Level Arena: %llu allocs %.1f KB\n heap: %llu blocks %.1f KB",
+                (unsigned long long)level_arena.allocations,
+                level_arena.bytes / 1024.0,
+                (unsigned long long)level_arena.blocks,
+                level_arena.block_bytes / 1024.0);
+    ImGui::Text("Frame Arena: %llu allocs %.1f KB\n heap: %llu blocks %.1f KB",
+                (unsigned long long)frame_arena.allocations,
+                frame_arena.bytes / 1024.0,
+                (unsigned long long)frame_arena.blocks,
+                frame_arena.block_bytes / 1024.0);
+    // operator new on any thread, a steady frame should show 0
+    ImGui::Text("Heap: %llu allocs last frame\n total: %llu allocs %.1f MB",
+                (unsigned long long)AllocCounter::LastFrame(),
+                (unsigned long long)AllocCounter::Allocations(),
+                AllocCounter::Bytes() / 1048576.0);
+    ImGui::Separator();  //------------------------
+    memory_shown = ImGui::CollapsingHeader("Memory");
+    if (memory_shown) {
+      GPUMemory gpu;
+      gpu.atlas_bytes = atlas.MemoryBytes();
+      window.MeasureMemory(gpu);
+      MemoryReport::DrawImGui(snapshot.level_memory, gpu);
+      if (ImGui::Button("Dump")) {
+        if (MemoryReport::Dump(memory_path, snapshot.level_memory, gpu))
+          TraceLog(LOG_INFO, "MEMORY: report written to %s", memory_path);
+      }
+      ImGui::SameLine();
+      ImGui::Text("to %s", memory_path);
+    }
+    ImGui::Separator();  //------------------------
+    if (ImGui::CollapsingHeader("Startup")) startup.DrawImGui();
+#ifdef PROFILER_ENABLED
+    ImGui::Separator();  //------------------------
+    if (ImGui::CollapsingHeader("Profiler")) {
+      ImGui::Text("F9: dump last %.0fs to %s", trace_seconds, trace_path);
+      Profiler::DrawImGui();
+    }
+    ImGui::Separator();  //------------------------
+    if (ImGui::CollapsingHeader("Input Latency")) Profiler::DrawLatencyImGui();
+#endif
     ImGui::End();
   }
+
+#ifdef PROFILER_ENABLED
+  if (IsKeyPressed(KEY_F9)) {
+    if (Profiler::DumpTrace(trace_path, trace_seconds))
+      TraceLog(LOG_INFO, "PROFILER: trace written to %s", trace_path);
+  }
+#endif
 }
 
 void CheckFullscreen() {
@@ -1,7 +1,14 @@
 #pragma once
 
-int main();
+class AtlasManager;
+class SSAAWindow;
+struct RenderSnapshot;
 
-void ImGuiDebugUI();
+int main(int argc, char** argv);
+
+void ImGuiDebugUI(const SSAAWindow& window,
+                  const AtlasManager& atlas,
+                  const RenderSnapshot& snapshot,
+                  bool threaded);
 
 void CheckFullscreen();
@@ -0,0 +1,113 @@
+#include "memory_report.hpp"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <string>
+
+u64 MemoryReport::TextureBytes(const ::Texture& texture) {
+  u64 bytes = 0;
+  for (int i = 0; i < std::max(texture.mipmaps, 1); i++) {
+    bytes += GetPixelDataSize(std::max(texture.width >> i, 1),
+                              std::max(texture.height >> i, 1),
+                              texture.format);
+  }
+  return bytes;
+}
+
+// a json string. Pack levels are named after their files, so anything goes
+static void WriteString(FILE* file, const std::string& text) {
+  fputc('"', file);
+  for (unsigned char c : text) {
+    if (c == '"' || c == '\\')
+      fprintf(file, "\\%c", c);
+    else if (c < 0x20)
+      fprintf(file, "\\u%04x", c);
+    else
+      fputc(c, file);
+  }
+  fputc('"', file);
+}
+
+void MemoryReport::WriteJson(FILE* file,
+                             const LevelMemory& level,
+                             const GPUMemory* gpu) {
+  auto u = [](u64 v) { return (unsigned long long)v; };
+  fprintf(file, "{\"level\":");
+  WriteString(file, level.name);
+  fprintf(file, ",\"total\":%llu,", u(level.Total()));
+  fprintf(file, "\"cells\":%llu,\"boards\":[", u(level.cell_bytes));
+  for (u32 i = 0; i < level.board_bytes.size(); i++)
+    fprintf(file, "%s%llu", i ? "," : "", u(level.board_bytes[i]));
+  fprintf(file,
+          "],\"chunked_boards\":%u,\"tiles\":%u,"
+          "\"neighbors\":%llu,\"neighbor_slack\":%llu,\"routes\":%llu,"
+          "\"zero_regions\":%llu,"
+          "\"portals\":%u,\"clone_portals\":%u,"
+          "\"rect_cache_entries\":%u,\"rect_cache\":%llu,\"endless\":%llu",
+          level.chunked_boards,
+          level.tiles,
+          u(level.neighbor_bytes),
+          u(level.neighbor_slack),
+          u(level.route_bytes),
+          u(level.zero_region_bytes),
+          level.portals,
+          level.clone_portals,
+          level.rect_cache_entries,
+          u(level.rect_cache_bytes),
+          u(level.endless_bytes));
+  if (gpu) {
+    fprintf(file,
+            ",\"gpu\":{\"atlas\":%llu,\"ssaa\":%llu,\"canvas\":%llu,"
+            "\"ssaa_scale\":%.3f}",
+            u(gpu->atlas_bytes),
+            u(gpu->ssaa_bytes),
+            u(gpu->canvas_bytes),
+            gpu->ssaa_scale);
+  }
+  fprintf(file, "}");
+}
+
+bool MemoryReport::Dump(const char* path,
+                        const LevelMemory& level,
+                        const GPUMemory& gpu) {
+  FILE* file = fopen(path, "w");
+  if (!file) return false;
+  WriteJson(file, level, &gpu);
+  fprintf(file, "\n");
+  fclose(file);
+  return true;
+}
+
+void MemoryReport::DrawImGui(const LevelMemory& level, const GPUMemory& gpu) {
+  auto kb = [](u64 bytes) { return bytes / 1024.0; };
+  ImGui::Text("Level \"%s\": %.1f KB", level.name.c_str(), kb(level.Total()));
+  ImGui::Text(" cells: %.1f KB in %zu boards, %u chunked (%u tiles)",
+              kb(level.cell_bytes),
+              level.board_bytes.size(),
+              level.chunked_boards,
+              level.tiles);
+  ImGui::Text(" neighbors: %.1f KB + %.1f KB slack",
+              kb(level.neighbor_bytes),
+              kb(level.neighbor_slack));
+  ImGui::Text(" routes: %.1f KB", kb(level.route_bytes));
+  if (level.zero_region_bytes)
+    ImGui::Text(" zero regions: %.1f KB", kb(level.zero_region_bytes));
+  ImGui::Text(" portals: %u, %u clone", level.portals, level.clone_portals);
+  ImGui::Text(" rect cache: %u boards %.1f KB",
+              level.rect_cache_entries,
+              kb(level.rect_cache_bytes));
+  if (level.endless_bytes)
+    ImGui::Text(" endless progress: %.1f KB", kb(level.endless_bytes));
+  if (ImGui::TreeNode("Per board")) {
+    for (u32 i = 0; i < level.board_bytes.size(); i++)
+      ImGui::Text("%u: %.1f KB", i, kb(level.board_bytes[i]));
+    ImGui::TreePop();
+  }
+  ImGui::Text("GPU: %.1f MB", (gpu.atlas_bytes + gpu.ssaa_bytes) / 1048576.0);
+  ImGui::Text(" atlas: %.1f MB", gpu.atlas_bytes / 1048576.0);
+  ImGui::Text(" SSAA target: %.1f MB, canvas %.1f MB at %.3fx",
+              gpu.ssaa_bytes / 1048576.0,
+              gpu.canvas_bytes / 1048576.0,
+              gpu.ssaa_scale);
+}
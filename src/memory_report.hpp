@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdio>
+
+#include "fixed_size_int.hpp"
+#include "logic.hpp"
+#include "rl.hpp"
+
+// what's on the GPU, only known with a window
+struct GPUMemory {
+  u64 atlas_bytes = 0;   // every atlas texture, mip chains included
+  u64 ssaa_bytes = 0;    // the pooled render targets, color and depth
+  u64 canvas_bytes = 0;  // the corner of it the canvas uses at ssaa_scale
+  float ssaa_scale = 0.0f;
+};
+
+// where memory goes, in the debug window or as json from
+// `--bench memory`, so a level or layout change that costs more shows up
+namespace MemoryReport {
+// with every mip level
+u64 TextureBytes(const ::Texture& texture);
+
+// one json object, gpu left out when null
+void WriteJson(FILE* file, const LevelMemory& level, const GPUMemory* gpu);
+bool Dump(const char* path, const LevelMemory& level, const GPUMemory& gpu);
+
+// call inside an ImGui window
+void DrawImGui(const LevelMemory& level, const GPUMemory& gpu);
+};  // namespace MemoryReport
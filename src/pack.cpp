@@ -0,0 +1,253 @@
+#include "pack.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "rl.hpp"
+
+namespace fs = std::filesystem;
+
+static const char* pack_dir = "levels";
+
+static constexpr u32 index_magic = 0x58495349;  // "ISIX"
+static constexpr u32 version = 1;
+
+// the pack's size and modification time are kept, a mismatch means the pack
+// was edited after the index was written
+struct Header {
+  u32 magic;
+  u32 version;
+  u64 source_size;
+  i64 source_time;
+  u32 count;
+  u32 padding;
+};
+
+// written once by Scan, read only after that
+static std::vector<Pack::Info> packs;
+
+static fs::path PackPath(std::string_view pack) {
+  return fs::path{pack_dir} / (std::string{pack} + ".toml");
+}
+
+static fs::path IndexPath(std::string_view pack) {
+  return fs::path{pack_dir} / (std::string{pack} + ".index");
+}
+
+// all zeros when the pack can't be looked at, count is filled in later
+static Header Stamp(const fs::path& path) {
+  Header header = {index_magic, version, 0, 0, 0, 0};
+  std::error_code error;
+  header.source_size = fs::file_size(path, error);
+  if (error) return {};
+  auto time = fs::last_write_time(path, error);
+  if (error) return {};
+  header.source_time = time.time_since_epoch().count();
+  return header;
+}
+
+static bool Matches(const Header& a, const Header& b) {
+  return a.magic == b.magic && a.version == b.version &&
+         a.source_size == b.source_size && a.source_time == b.source_time;
+}
+
+static std::string_view Trim(std::string_view text) {
+  auto first = text.find_first_not_of(" \t\r");
+  if (first == std::string_view::npos) return {};
+  auto last = text.find_last_not_of(" \t\r");
+  return text.substr(first, last - first + 1);
+}
+
+// "board3" or "board3image"
+static bool IsBoardKey(std::string_view line) {
+  auto equals = line.find('=');
+  if (equals == std::string_view::npos) return false;
+  auto key = Trim(line.substr(0, equals));
+  if (key.substr(0, 5) != "board") return false;
+  key.remove_prefix(5);
+  auto digits = key.find_first_not_of("0123456789");
+  if (digits == 0) return false;
+  return digits == std::string_view::npos || key.substr(digits) == "image";
+}
+
+// one pass over the whole pack, only when its index is missing or outdated.
+// A table header outside multi line strings starts a level, unless it's a sub
+// table of the current one
+static std::vector<Pack::Entry> Build(std::string_view text) {
+  std::vector<Pack::Entry> entries;
+  std::string_view current;
+  bool in_string = false;
+  size_t pos = 0;
+  while (pos < text.size()) {
+    size_t end = std::min(text.find('\n', pos), text.size());
+    auto line = Trim(text.substr(pos, end - pos));
+    size_t start = pos;
+    pos = end + 1;
+
+    u32 quotes = 0;
+    for (auto q = line.find("\"\"\""); q != std::string_view::npos;
+         q = line.find("\"\"\"", q + 3))
+      quotes++;
+    bool was_in_string = in_string;
+    if (quotes % 2) in_string = !in_string;
+
+    if (was_in_string) {
+      // a board row, two characters a cell
+      if (in_string && !entries.empty())
+        entries.back().cells += line.size() / 2;
+      continue;
+    }
+    if (entries.size() && IsBoardKey(line)) entries.back().boards++;
+    if (line.size() < 3 || line[0] != '[' || line[1] == '[') continue;
+
+    auto key = line.substr(1, line.find_first_of(".]") - 1);
+    key = Trim(key);
+    if (key.size() >= 2 && key.front() == '"')
+      key = key.substr(1, key.size() - 2);
+    if (key == current) continue;
+
+    if (!entries.empty())
+      entries.back().length = start - entries.back().offset;
+    current = key;
+    Pack::Entry entry = {};
+    auto length = std::min(key.size(), sizeof(entry.key) - 1);
+    strncpy(entry.key, key.data(), length);
+    entry.offset = start;
+    entries.push_back(entry);
+  }
+  if (!entries.empty())
+    entries.back().length = text.size() - entries.back().offset;
+  return entries;
+}
+
+static std::optional<std::string> ReadFile(const fs::path& path) {
+  auto file = std::ifstream{path, std::ios::binary};
+  if (!file) return {};
+  std::string text;
+  file.seekg(0, std::ios::end);
+  text.resize(file.tellg());
+  file.seekg(0);
+  file.read(text.data(), text.size());
+  if (!file) return {};
+  return text;
+}
+
+// count 0 when it has to be built again
+static Header ReadHeader(std::string_view pack, const Header& stamp) {
+  auto file = std::ifstream{IndexPath(pack), std::ios::binary};
+  Header header = {};
+  file.read((char*)&header, sizeof(header));
+  if (!file || !Matches(header, stamp)) return {};
+  return header;
+}
+
+static u32 Rebuild(std::string_view pack, const Header& stamp) {
+  auto text = ReadFile(PackPath(pack));
+  if (!text) return 0;
+  auto entries = Build(text.value());
+
+  Header header = stamp;
+  header.count = entries.size();
+  auto file =
+      std::ofstream{IndexPath(pack), std::ios::binary | std::ios::trunc};
+  file.write((const char*)&header, sizeof(header));
+  file.write((const char*)entries.data(),
+             entries.size() * sizeof(Pack::Entry));
+  if (!file) {
+    // still playable, the index is just rebuilt next time
+    TraceLog(LOG_WARNING,
+             "PACK: failed to write index of %s",
+             std::string{pack}.c_str());
+  }
+  return entries.size();
+}
+
+void Pack::Scan() {
+  packs.clear();
+  std::error_code error;
+  for (auto& file : fs::directory_iterator{pack_dir, error}) {
+    if (file.path().extension() != ".toml") continue;
+    auto name = file.path().stem().string();
+    auto stamp = Stamp(file.path());
+    u32 levels = ReadHeader(name, stamp).count;
+    if (levels == 0) levels = Rebuild(name, stamp);
+    if (levels > 0) packs.push_back({name, levels});
+  }
+  std::sort(packs.begin(), packs.end(), [](auto& a, auto& b) {
+    return a.name < b.name;
+  });
+}
+
+const std::vector<Pack::Info>& Pack::All() {
+  return packs;
+}
+
+u32 Pack::Count(std::string_view pack) {
+  for (auto& info : packs) {
+    if (info.name == pack) return info.levels;
+  }
+  return 0;
+}
+
+bool Pack::Split(std::string_view name, std::string_view& pack, u32& number) {
+  auto slash = name.rfind('/');
+  if (slash == std::string_view::npos || slash == 0) return false;
+  auto digits = name.substr(slash + 1);
+  auto result =
+      std::from_chars(digits.data(), digits.data() + digits.size(), number);
+  if (result.ec != std::errc{} || result.ptr != digits.end() || number == 0)
+    return false;
+  pack = name.substr(0, slash);
+  return true;
+}
+
+std::string Pack::Name(std::string_view pack, u32 number) {
+  return std::string{pack} + "/" + std::to_string(number);
+}
+
+std::string Pack::Folder(std::string_view name) {
+  std::string_view pack;
+  u32 number;
+  if (!Split(name, pack, number)) return {};
+  return PackPath(pack).parent_path().string();
+}
+
+std::optional<Pack::Entry> Pack::Find(std::string_view pack, u32 number) {
+  if (number == 0 || number > Count(pack)) return {};
+  auto file = std::ifstream{IndexPath(pack), std::ios::binary};
+  file.seekg(sizeof(Header) + (number - 1) * sizeof(Entry));
+  Entry entry;
+  file.read((char*)&entry, sizeof(entry));
+  if (!file) return {};
+  return entry;
+}
+
+std::optional<std::string> Pack::ReadLevel(std::string_view name) {
+  std::string_view pack;
+  u32 number;
+  if (!Split(name, pack, number)) return {};
+
+  auto path = PackPath(pack);
+  auto stamp = Stamp(path);
+  auto entry = ReadHeader(pack, stamp).count ? Find(pack, number)
+                                             : std::optional<Entry>{};
+  if (!entry) {
+    // edited while playing. Scan owns the index file, so this only looks
+    auto text = ReadFile(path);
+    if (!text) return {};
+    auto entries = Build(text.value());
+    if (number > entries.size()) return {};
+    auto& found = entries[number - 1];
+    return text->substr(found.offset, found.length);
+  }
+
+  auto file = std::ifstream{path, std::ios::binary};
+  std::string text(entry->length, '\0');
+  file.seekg(entry->offset);
+  file.read(text.data(), text.size());
+  if (!file) return {};
+  return text;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "fixed_size_int.hpp"
+
+// level packs, levels/<pack>.toml, each holding tables in the same format as
+// levels.toml. The nth table is level n of the pack, whatever its key, and is
+// named "<pack>/<n>" everywhere else.
+// levels/<pack>.index is written next to the pack: a header and one fixed size
+// record per level, so startup only reads headers and finding a level is a
+// seek, no matter how many levels a pack has
+namespace Pack {
+struct Entry {
+  char key[16];  // table key, cut short if longer
+  u64 offset;    // of the table header in the pack
+  u32 length;    // up to the next level's header
+  u32 boards;
+  u64 cells;  // counted in text boards, image boards add none
+};
+
+struct Info {
+  std::string name;
+  u32 levels;
+};
+
+// lists levels/ and rebuilds missing or outdated indexes. Call before loading
+// any pack level, the list isn't touched again
+void Scan();
+const std::vector<Info>& All();
+// 0 when there's no such pack
+u32 Count(std::string_view pack);
+
+// "classic/12" is pack "classic", level 12. false for levels.toml's levels
+bool Split(std::string_view name, std::string_view& pack, u32& number);
+std::string Name(std::string_view pack, u32 number);
+// the folder of the file a level is in, image boards are relative to it.
+// Empty for levels.toml's levels, it's read from the working directory
+std::string Folder(std::string_view name);
+
+// the record of a level, 1 based
+std::optional<Entry> Find(std::string_view pack, u32 number);
+// just the level's own table as text, ready for toml::parse. Safe to call
+// from the loading thread. A pack edited since the index was written is
+// scanned again, so hot reloading still works
+std::optional<std::string> ReadLevel(std::string_view name);
+};  // namespace Pack
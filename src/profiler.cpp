@@ -0,0 +1,291 @@
+#include "profiler.hpp"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// ~2MB a thread, a couple seconds of frames even with every zone busy
+static constexpr u32 max_events = 1 << 16;
+// histogram columns
+static constexpr u32 history = 240;
+// a minute of presented frames at 60 fps
+static constexpr u32 max_latencies = 1 << 12;
+// of the latency distribution, 1ms each. The last one takes everything longer
+static constexpr u32 latency_buckets = 100;
+
+struct Event {
+  u32 zone;
+  u32 thread;
+  u64 start;
+  u64 duration;
+};
+
+struct ZoneStats {
+  const char* name;
+  float ms[history] = {};
+};
+
+// one per thread that ever ran a zone. Its mutex is only contended while
+// FrameMark or DumpTrace read it
+struct ThreadBuffer {
+  std::mutex mutex;
+  u32 thread = 0;
+  std::vector<Event> events;  // ring buffer
+  u64 event_count = 0;        // total ever recorded, ring index is % max
+  std::vector<u64> this_frame;  // per zone, summed, can run multiple times
+};
+
+// guards everything below, zone exits never take it
+static std::mutex mutex;
+static std::vector<ZoneStats> zones;  // by id
+static u32 column = 0;
+// buffers outlive their threads so their events still get dumped. A thread
+// that exits hands its buffer to the next one starting, which matters for
+// thread pools coming and going
+static std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+static std::vector<ThreadBuffer*> free_buffers;
+static u32 thread_count = 0;
+static std::vector<InputLatency> latencies;  // ring buffer like events
+static u64 latency_count = 0;
+
+static const auto epoch = std::chrono::steady_clock::now();
+
+namespace {
+struct BufferLease {
+  ThreadBuffer* buffer;
+  BufferLease() {
+    std::lock_guard lock(mutex);
+    if (free_buffers.empty()) {
+      buffers.push_back(std::make_unique<ThreadBuffer>());
+      buffer = buffers.back().get();
+    } else {
+      buffer = free_buffers.back();
+      free_buffers.pop_back();
+    }
+    // events already recorded keep the old thread's index
+    std::lock_guard buffer_lock(buffer->mutex);
+    buffer->thread = thread_count++;
+  }
+  ~BufferLease() {
+    std::lock_guard lock(mutex);
+    free_buffers.push_back(buffer);
+  }
+};
+}  // namespace
+
+static ThreadBuffer& LocalBuffer() {
+  thread_local BufferLease lease;
+  return *lease.buffer;
+}
+
+u64 Profiler::Now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - epoch)
+      .count();
+}
+
+u32 Profiler::ZoneId(const char* name) {
+  std::lock_guard lock(mutex);
+  // once per call site, linear is fine. Same literal in different
+  // translation units can have different addresses, so strcmp
+  auto it = std::find_if(zones.begin(), zones.end(), [name](auto& zone) {
+    return zone.name == name || strcmp(zone.name, name) == 0;
+  });
+  if (it == zones.end()) it = zones.insert(zones.end(), ZoneStats{name});
+  return it - zones.begin();
+}
+
+Profiler::Zone::Zone(u32 id) : id(id), start(Now()) {}
+
+Profiler::Zone::~Zone() {
+  u64 end = Now();
+  auto& buffer = LocalBuffer();
+
+  std::lock_guard lock(buffer.mutex);
+  if (buffer.events.empty()) buffer.events.resize(max_events);
+  buffer.events[buffer.event_count % max_events] = {
+      id, buffer.thread, start, end - start};
+  buffer.event_count++;
+  if (id >= buffer.this_frame.size()) buffer.this_frame.resize(id + 1);
+  buffer.this_frame[id] += end - start;
+}
+
+void Profiler::FrameMark() {
+  std::lock_guard lock(mutex);
+  for (auto& zone : zones) zone.ms[column] = 0;
+  for (auto& buffer : buffers) {
+    std::lock_guard buffer_lock(buffer->mutex);
+    for (u32 id = 0; id < buffer->this_frame.size(); id++) {
+      zones[id].ms[column] += buffer->this_frame[id] / 1e6f;
+      buffer->this_frame[id] = 0;
+    }
+  }
+  column = (column + 1) % history;
+}
+
+void Profiler::RecordLatency(const InputLatency& latency) {
+  if (!latency.sampled || latency.presented < latency.sampled) return;
+  std::lock_guard lock(mutex);
+  if (latencies.empty()) latencies.resize(max_latencies);
+  latencies[latency_count % max_latencies] = latency;
+  latency_count++;
+}
+
+static float Ms(u64 from, u64 to) {
+  return from && to > from ? (to - from) / 1e6f : 0.0f;
+}
+
+void Profiler::DrawImGui() {
+  std::lock_guard lock(mutex);
+  for (auto& zone : zones) {
+    float max = 0;
+    float sum = 0;
+    for (float ms : zone.ms) {
+      max = std::max(max, ms);
+      sum += ms;
+    }
+    char overlay[64];
+    snprintf(overlay, 64, "avg %.3fms max %.3fms", sum / history, max);
+    ImGui::PlotHistogram(zone.name,
+                         zone.ms,
+                         history,
+                         column,  // oldest column first
+                         overlay,
+                         0.0f,
+                         FLT_MAX,
+                         ImVec2(240, 40));
+  }
+}
+
+void Profiler::DrawLatencyImGui() {
+  std::lock_guard lock(mutex);
+  u32 count = std::min<u64>(latency_count, max_latencies);
+  if (count == 0) {
+    ImGui::Text("no input presented yet");
+    return;
+  }
+
+  // newest last, at most a histogram's worth rolling
+  float rolling[history] = {};
+  u32 rolling_count = std::min(count, history);
+  float buckets[latency_buckets] = {};
+  std::vector<float> sorted;
+  sorted.reserve(count);
+  float queued = 0, simulated = 0, presenting = 0;
+  for (u32 i = 0; i < count; i++) {
+    auto& latency = latencies[(latency_count - count + i) % max_latencies];
+    float ms = Ms(latency.sampled, latency.presented);
+    sorted.push_back(ms);
+    buckets[std::min<u32>(ms, latency_buckets - 1)]++;
+    if (i + rolling_count >= count) rolling[i + rolling_count - count] = ms;
+    queued += Ms(latency.sampled, latency.ticked);
+    simulated += Ms(latency.ticked, latency.drawn);
+    presenting += Ms(latency.drawn, latency.presented);
+  }
+  std::sort(sorted.begin(), sorted.end());
+  auto percentile = [&](float p) {
+    return sorted[std::min<u32>(count * p, count - 1)];
+  };
+
+  char overlay[64];
+  snprintf(overlay,
+           64,
+           "p50 %.1fms p99 %.1fms max %.1fms",
+           percentile(0.5f),
+           percentile(0.99f),
+           sorted.back());
+  ImGui::PlotHistogram("input to present",
+                       rolling,
+                       rolling_count,
+                       0,
+                       overlay,
+                       0.0f,
+                       FLT_MAX,
+                       ImVec2(240, 40));
+  ImGui::PlotHistogram("distribution, 1ms bins",
+                       buckets,
+                       latency_buckets,
+                       0,
+                       nullptr,
+                       0.0f,
+                       FLT_MAX,
+                       ImVec2(240, 40));
+  ImGui::Text("avg queued %.2fms simulated %.2fms presenting %.2fms",
+              queued / count,
+              simulated / count,
+              presenting / count);
+  ImGui::Text("%u frames", count);
+}
+
+bool Profiler::DumpTrace(const char* path, double seconds) {
+  FILE* file = fopen(path, "w");
+  if (!file) return false;
+
+  std::lock_guard lock(mutex);
+  // unsigned, a process younger than `seconds` would wrap around
+  u64 now = Now();
+  u64 window = seconds * 1e9;
+  u64 cutoff = now > window ? now - window : 0;
+
+  fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  bool comma = false;
+  for (auto& buffer : buffers) {
+    std::lock_guard buffer_lock(buffer->mutex);
+    u64 count = buffer->event_count;
+    u64 first = count > max_events ? count - max_events : 0;
+    for (u64 i = first; i < count; i++) {
+      auto& event = buffer->events[i % max_events];
+      if (event.start + event.duration < cutoff) continue;
+      // timestamps are in microseconds
+      fprintf(file,
+              "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+              "\"ts\":%.3f,\"dur\":%.3f}",
+              comma ? ",\n" : "",
+              zones[event.zone].name,
+              event.thread,
+              event.start / 1e3,
+              event.duration / 1e3);
+      comma = true;
+    }
+  }
+
+  // latencies overlap each other, so they're async events, each frame on its
+  // own row with its stages nested inside
+  auto async = [&](const char* name, char phase, u64 id, u64 time) {
+    fprintf(file,
+            "%s{\"name\":\"%s\",\"cat\":\"latency\",\"ph\":\"%c\","
+            "\"id\":%llu,\"pid\":1,\"tid\":0,\"ts\":%.3f}",
+            comma ? ",\n" : "",
+            name,
+            phase,
+            (unsigned long long)id,
+            time / 1e3);
+    comma = true;
+  };
+  auto stage = [&](const char* name, u64 id, u64 begin, u64 end) {
+    if (!begin || end < begin) return;
+    async(name, 'b', id, begin);
+    async(name, 'e', id, end);
+  };
+  u64 first = latency_count > max_latencies ? latency_count - max_latencies : 0;
+  for (u64 i = first; i < latency_count; i++) {
+    auto& latency = latencies[i % max_latencies];
+    if (latency.presented < cutoff) continue;
+    async("input to present", 'b', i, latency.sampled);
+    stage("queued", i, latency.sampled, latency.ticked);
+    stage("simulated", i, latency.ticked, latency.drawn);
+    if (latency.handled) async("handled", 'n', i, latency.handled);
+    stage("presenting", i, latency.drawn, latency.presented);
+    async("input to present", 'e', i, latency.presented);
+  }
+  fprintf(file, "\n]}\n");
+  fclose(file);
+  return true;
+}
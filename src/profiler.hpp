@@ -0,0 +1,74 @@
+#pragma once
+
+#include "fixed_size_int.hpp"
+
+// scoped timing zones. Always on in debug builds, release builds only get them
+// with -DINFINISWEEPER_PROFILE=ON, otherwise every macro compiles to nothing
+#if !defined(NDEBUG) || defined(INFINISWEEPER_PROFILE)
+  #define PROFILER_ENABLED
+#endif
+
+#ifdef PROFILER_ENABLED
+  #define PROFILE_CONCAT_INNER(a, b) a##b
+  #define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+  // name must be a string literal, it's kept around by pointer. Each call
+  // site looks its zone up once, the first time it runs
+  #define PROFILE_ZONE(name)                                 \
+    static const u32 PROFILE_CONCAT(profile_id_, __LINE__) = \
+        Profiler::ZoneId(name);                              \
+    Profiler::Zone PROFILE_CONCAT(profile_zone_, __LINE__) { \
+      PROFILE_CONCAT(profile_id_, __LINE__)                  \
+    }
+  #define PROFILE_FRAME() Profiler::FrameMark()
+  // stamps stage of an InputLatency with the current time
+  #define PROFILE_LATENCY(latency, stage) (latency).stage = Profiler::Now()
+#else
+  #define PROFILE_ZONE(name)
+  #define PROFILE_FRAME()
+  #define PROFILE_LATENCY(latency, stage)
+#endif
+
+// how long one input frame took to reach the screen, Profiler::Now() at each
+// stage or 0 if it never got there. Travels with the frame through the input
+// queue into its snapshot
+struct InputLatency {
+  u64 sampled = 0;    // captured on the window thread
+  u64 ticked = 0;     // Scene::Tick started on it
+  u64 handled = 0;    // Level::HandleMouseInput returned
+  u64 drawn = 0;      // its draw lists were recorded
+  u64 presented = 0;  // the frame showing it was swapped
+};
+
+namespace Profiler {
+// nanoseconds since the profiler started
+u64 Now();
+
+// index of the zone called name, registering it the first time. Zones with
+// the same name from different call sites share one
+u32 ZoneId(const char* name);
+
+// records into a buffer owned by the calling thread, so threads only wait on
+// each other while a frame is marked or a trace dumped
+struct Zone {
+  u32 id;
+  u64 start;
+  Zone(u32 id);
+  ~Zone();
+};
+
+// once per frame, closes the current column of every zone's histogram
+void FrameMark();
+
+// once per presented frame that shows a newer input frame than the last one,
+// with presented stamped
+void RecordLatency(const InputLatency& latency);
+
+// rolling per-zone histograms, call inside an ImGui window
+void DrawImGui();
+// input to present, rolling and as a distribution, same
+void DrawLatencyImGui();
+
+// writes the last `seconds` of zones and input latencies as Chrome/Perfetto
+// trace json, load it in chrome://tracing or ui.perfetto.dev
+bool DumpTrace(const char* path, double seconds);
+};  // namespace Profiler
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "fixed_size_int.hpp"
+
+// tiny splitmix64 generator. raylib's GetRandomValue wraps the global rand(),
+// which can't be used from the loading thread and can't be replayed from a
+// seed, so every level carries one of these instead
+struct Rng {
+  u64 state = 0;
+
+  inline explicit Rng(u64 seed = 0) : state(seed){};
+
+  inline u64 Next() {
+    u64 z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+  };
+
+  // both sides inclusive, same as GetRandomValue
+  inline i32 Range(i32 min, i32 max) {
+    if (min > max) return Range(max, min);
+    return min + (i32)(Next() % ((u64)max - min + 1));
+  };
+};
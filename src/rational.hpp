@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdlib>
+#include <numeric>
+
+#include "fixed_size_int.hpp"
+
+// exact fractions for portal geometry. Every board size and portal offset is
+// an integer, so where a cell of one board lands in another is too, as a
+// fraction. Floats lose that a few boards deep. Always reduced, den > 0
+struct Rational {
+  i64 num = 0;
+  i64 den = 1;
+
+  inline constexpr Rational() = default;
+  inline constexpr Rational(i64 num) : num(num), den(1){};
+  inline Rational(i64 num, i64 den) : num(num), den(den) {
+    if (this->den < 0) {
+      this->num = -this->num;
+      this->den = -this->den;
+    }
+    i64 g = std::gcd(this->num, this->den);
+    if (g > 1) {
+      this->num /= g;
+      this->den /= g;
+    }
+  };
+
+  // rounding toward negative infinity, unlike integer division
+  inline i64 Floor() const {
+    return num >= 0 ? num / den : -((-num + den - 1) / den);
+  };
+  inline i64 Ceil() const { return -Rational{-num, den}.Floor(); };
+};
+
+// reducing across before multiplying keeps the numbers small, nesting depth is
+// bounded by the neighbor search so this doesn't overflow in practice
+inline Rational operator*(Rational a, Rational b) {
+  i64 g1 = std::gcd(a.num, b.den);
+  i64 g2 = std::gcd(b.num, a.den);
+  if (g1 == 0) g1 = 1;
+  if (g2 == 0) g2 = 1;
+  return Rational{(a.num / g1) * (b.num / g2), (a.den / g2) * (b.den / g1)};
+}
+
+inline Rational operator/(Rational a, Rational b) {
+  return a * Rational{b.den, b.num};
+}
+
+inline Rational operator+(Rational a, Rational b) {
+  i64 g = std::gcd(a.den, b.den);
+  return Rational{a.num * (b.den / g) + b.num * (a.den / g),
+                  a.den / g * b.den};
+}
+
+inline Rational operator-(Rational a, Rational b) {
+  return a + Rational{-b.num, b.den};
+}
+
+// both are reduced, so equal values have equal terms
+inline bool operator==(Rational a, Rational b) {
+  return a.num == b.num && a.den == b.den;
+}
+
+struct RationalRect {
+  Rational x;
+  Rational y;
+  Rational width;
+  Rational height;
+};
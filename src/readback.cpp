@@ -0,0 +1,69 @@
+#include "readback.hpp"
+
+#ifdef __APPLE__
+  #define GL_SILENCE_DEPRECATION
+#else
+  #include <glad/gl.h>
+#endif
+#include <external/glfw/include/GLFW/glfw3.h>
+#include <rlgl.h>
+
+#include <algorithm>
+
+Readback::Readback(u32 depth) : slots(std::max(depth, 1u)) {
+  for (auto& slot : slots) glGenBuffers(1, &slot.buffer);
+}
+
+Readback::~Readback() {
+  for (auto& slot : slots) glDeleteBuffers(1, &slot.buffer);
+}
+
+void Readback::Queue(u32 framebuffer,
+                     u32 width,
+                     u32 height,
+                     const Callback& done) {
+  auto& slot = slots[queued % slots.size()];
+  // its copy has had `depth` frames to finish, mapping it shouldn't wait
+  if (slot.queued) Collect(slot, done);
+
+  // raylib batches, whatever is still in the batch isn't in the target yet
+  rlDrawRenderBatchActive();
+  u64 bytes = (u64)width * height * 4;
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+  if (bytes > slot.capacity) {
+    glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+    slot.capacity = bytes;
+  }
+  rlEnableFramebuffer(framebuffer);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  // with a pack buffer bound this only queues the copy, the pointer is an
+  // offset into it
+  glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  rlDisableFramebuffer();
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  slot.index = queued++;
+  slot.width = width;
+  slot.height = height;
+  slot.queued = true;
+}
+
+void Readback::Flush(const Callback& done) {
+  // the oldest is the one Queue would have collected next
+  for (u32 i = 0; i < slots.size(); i++) {
+    auto& slot = slots[(queued + i) % slots.size()];
+    if (slot.queued) Collect(slot, done);
+  }
+}
+
+void Readback::Collect(Slot& slot, const Callback& done) {
+  slot.queued = false;
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+  auto* data = (const u8*)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+  if (data) {
+    u64 bytes = (u64)slot.width * slot.height * 4;
+    done({slot.index, slot.width, slot.height, {data, bytes}});
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
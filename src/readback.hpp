@@ -0,0 +1,50 @@
+#pragma once
+
+#include <functional>
+#include <span>
+#include <vector>
+
+#include "fixed_size_int.hpp"
+
+// reads frames back from the GPU through pixel buffer objects without waiting
+// on them. Queue only starts a copy into one of `depth` buffers, the copy it
+// hands out is the one queued `depth` calls ago, which the GPU finished while
+// the frames after it were drawn. RGBA8, rows bottom up the way GL has them.
+// Needs the GL context, call it from the thread owning the window
+class Readback {
+ public:
+  struct Frame {
+    u64 index;  // counts Queue calls from 0
+    u32 width;
+    u32 height;
+    std::span<const u8> pixels;  // only valid inside the callback
+  };
+  using Callback = std::function<void(const Frame&)>;
+
+  Readback(u32 depth = 2);
+  Readback(const Readback&) = delete;  // would free the buffers twice
+  ~Readback();
+
+  // starts copying the bottom left width x height of a framebuffer (a render
+  // texture's id, 0 is the window), done gets the frame it pushed out if any.
+  // Leaves the window's framebuffer bound, so not while drawing into a
+  // texture: after SSAAWindow::BeginUI, say
+  void Queue(u32 framebuffer, u32 width, u32 height, const Callback& done);
+  // done gets every frame still in flight, oldest first
+  void Flush(const Callback& done);
+
+ private:
+  struct Slot {
+    u32 buffer = 0;
+    u64 capacity = 0;  // bytes
+    u64 index = 0;
+    u32 width = 0;
+    u32 height = 0;
+    bool queued = false;
+  };
+  // maps the slot, hands it out and frees it up
+  void Collect(Slot& slot, const Callback& done);
+
+  std::vector<Slot> slots;
+  u64 queued = 0;
+};
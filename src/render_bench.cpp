@@ -0,0 +1,453 @@
+// Bench::Render and Bench::Capture, apart from the other benchmarks since
+// they're the only ones with a window and GL
+
+#ifdef __APPLE__
+  #define GL_SILENCE_DEPRECATION
+#else
+  #include <glad/gl.h>
+#endif
+#include <external/glfw/include/GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "asset_pack.hpp"
+#include "atlas.hpp"
+#include "bench.hpp"
+#include "draw_list.hpp"
+#include "input.hpp"
+#include "logic.hpp"
+#include "readback.hpp"
+#include "serializer.hpp"
+#include "ssaa_window.hpp"
+#include "transform.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+// the path is stepped as if every frame took this long, whatever it took
+static constexpr float frame_time = 1.0f / 60.0f;
+// per frame while diving and rising
+static constexpr float dive_factor = 1.04f;
+
+// GL draw calls since the last reset. raylib issues them through glad's
+// pointers, which are swapped for counting ones
+static u64 gl_draw_calls = 0;
+#ifndef __APPLE__
+static PFNGLDRAWELEMENTSPROC real_draw_elements;
+static PFNGLDRAWARRAYSPROC real_draw_arrays;
+
+static void GLAD_API_PTR CountDrawElements(GLenum mode,
+                                           GLsizei count,
+                                           GLenum type,
+                                           const void* indices) {
+  gl_draw_calls++;
+  real_draw_elements(mode, count, type, indices);
+}
+
+static void GLAD_API_PTR CountDrawArrays(GLenum mode,
+                                         GLint first,
+                                         GLsizei count) {
+  gl_draw_calls++;
+  real_draw_arrays(mode, first, count);
+}
+
+static void CountDrawCalls() {
+  real_draw_elements = glad_glDrawElements;
+  real_draw_arrays = glad_glDrawArrays;
+  glad_glDrawElements = CountDrawElements;
+  glad_glDrawArrays = CountDrawArrays;
+}
+#else
+static void CountDrawCalls() {}  // stays 0, no glad to hook
+#endif
+
+// one frame of the path
+struct FrameStats {
+  double ms;
+  u64 draw_calls;
+  u32 commands;
+  u32 boards;  // instances drawn cell by cell
+  u32 copied;  // instances portal feedback covered
+  u32 cells;
+};
+
+// the portal the dive heads for, clone ones first so zooming back out goes
+// through the clone logic. Empty when the root has no way down
+static optional<rl::Vector2> DiveTarget(const vector<Portal>& portals,
+                                        u32 root) {
+  const Portal* best = nullptr;
+  for (auto& portal : portals) {
+    if (portal.from != root) continue;
+    if (!best || (portal.clone && !best->clone)) best = &portal;
+  }
+  if (!best) return {};
+  return rl::Vector2{best->x + best->width / 2.0f,
+                     best->y + best->height / 2.0f};
+}
+
+// before the window opens. Mesa's llvmpipe, so results compare between boxes
+// with different GPUs or none. Without a display, run under xvfb-run
+static void HideWindow(bool software) {
+#ifndef _WIN32
+  if (software) setenv("LIBGL_ALWAYS_SOFTWARE", "1", 1);
+#endif
+  SetTraceLogLevel(LOG_WARNING);
+  SetConfigFlags(FLAG_WINDOW_HIDDEN);
+}
+
+// after it opened, nothing may wait for the display or a frame cap
+static void Unthrottle() {
+  ClearWindowState(FLAG_VSYNC_HINT);
+  SetTargetFPS(0);
+}
+
+static AtlasManager LoadAtlas() {
+  AssetPack assets{"res/assets.pack"};
+  AtlasSources sources;
+  sources.tile = PendingTexture::Decode(assets, "tile");
+  for (u32 i = 0; i < 2; i++) {
+    sources.number[i] =
+        PendingTexture::Decode(assets, "number_" + std::to_string(i));
+  }
+  sources.ui = PendingTexture::Decode(assets, "ui");
+  sources.logo = PendingTexture::Decode(assets, "logo");
+  return AtlasManager{std::move(sources)};
+}
+
+static void Print(const std::string& level,
+                  std::string_view segment,
+                  vector<FrameStats> frames) {
+  if (frames.empty()) return;
+  std::sort(frames.begin(), frames.end(), [](auto& a, auto& b) {
+    return a.ms < b.ms;
+  });
+  auto percentile = [&](double p) {
+    return frames[std::min<size_t>(frames.size() * p, frames.size() - 1)].ms;
+  };
+  FrameStats sum = {}, max = {};
+  for (auto& frame : frames) {
+    sum.draw_calls += frame.draw_calls;
+    sum.commands += frame.commands;
+    sum.boards += frame.boards;
+    sum.copied += frame.copied;
+    sum.cells += frame.cells;
+    max.boards = std::max(max.boards, frame.boards);
+    max.cells = std::max(max.cells, frame.cells);
+  }
+  double n = frames.size();
+  printf("%s,%.*s,%zu,%.3f,%.3f,%.3f,%.3f,%.1f,%.1f,%.1f,%u,%.1f,%.1f,%u\n",
+         level.c_str(),
+         (int)segment.size(),
+         segment.data(),
+         frames.size(),
+         percentile(0.5),
+         percentile(0.9),
+         percentile(0.99),
+         frames.back().ms,
+         sum.draw_calls / n,
+         sum.commands / n,
+         sum.boards / n,
+         max.boards,
+         sum.copied / n,
+         sum.cells / n,
+         max.cells);
+  fflush(stdout);
+}
+
+bool Bench::Render(std::vector<std::string> args) {
+  std::vector<std::string> levels;
+  u32 width = 1280;
+  u32 height = 720;
+  float scale = 2.0f;
+  u32 frames = 240;  // per segment
+  bool software = true;
+  for (auto& arg : args) {
+    auto split = arg.find('=');
+    auto key = arg.substr(0, split);
+    auto value = split == std::string::npos ? "" : arg.substr(split + 1);
+    if (key == "width") {
+      width = std::atoi(value.c_str());
+    } else if (key == "height") {
+      height = std::atoi(value.c_str());
+    } else if (key == "scale") {
+      scale = std::atof(value.c_str());
+    } else if (key == "frames") {
+      frames = std::atoi(value.c_str());
+    } else if (key == "gpu") {
+      software = false;
+    } else if (split == std::string::npos) {
+      levels.push_back(arg);
+    } else {
+      fprintf(stderr, "unknown parameter %s\n", arg.c_str());
+      return false;
+    }
+  }
+  // the self-recursing menu, a level of clones and a plain one
+  if (levels.empty()) levels = {"mainmenu", "16", "1"};
+
+  HideWindow(software);
+  auto window = SSAAWindow{width, height, scale, "InfiniSweeper bench"};
+  Unthrottle();
+  CountDrawCalls();
+  auto atlas = LoadAtlas();
+
+  printf("# %s, %ux%u at x%.2f, %u frames a segment\n",
+         (const char*)glGetString(GL_RENDERER),
+         width,
+         height,
+         scale,
+         frames);
+  printf("level,segment,frames,p50_ms,p90_ms,p99_ms,max_ms,draw_calls,"
+         "commands,boards,max_boards,copied,cells,max_cells\n");
+
+  InputFrame input;
+  input.frame_time = frame_time;
+  input.view = window.GetView();
+  input.mouse_position = input.view.window_size / 2;
+  Input::Begin(input);
+
+  DrawList list;
+  for (auto& name : levels) {
+    Level level;
+    // same seed every run, so runs compare
+    Serializer::Parse(name, level, 0, 1);
+    Serializer::Activate(level);
+    auto home = camera_coord;
+    float home_zoom = camera_zoom;
+    auto& root = level.boards[level.root_board];
+    float radius = std::min(root.width, root.height) * 0.3f;
+
+    // pans around the root at the starting zoom, dives into portals as deep
+    // as they go and rises back out, through clones' parents where there
+    // are any
+    for (std::string_view segment : {"pan", "dive", "rise"}) {
+      vector<FrameStats> stats;
+      for (u32 i = 0; i < frames; i++) {
+        auto start = Clock::now();
+        gl_draw_calls = 0;
+
+        float t = 2.0f * PI * i / frames;
+        if (segment == "pan") {
+          camera_coord = home + rl::Vector2{std::sin(t), std::sin(2 * t) / 2} *
+                                    radius;
+          camera_zoom = home_zoom;
+        } else if (segment == "dive") {
+          auto target = DiveTarget(level.portals, level.root_board);
+          if (target) camera_coord += (target.value() - camera_coord) * 0.1f;
+          camera_zoom *= dive_factor;
+        } else {
+          camera_zoom /= dive_factor;
+        }
+        CoordTransform::UpdateCameraWorldRect();
+        camera_moved = true;
+
+        level.Tick();
+        list.Clear();
+        level.Draw(list);
+
+        window.BeginDrawing();
+        ClearBackground(Color{40, 48, 65, 255});
+        list.Replay(atlas, window.Feedback());
+        if (list.HasFeedback()) window.CaptureFeedback();
+        window.BeginUI();
+        window.BeginImGui();
+        window.EndDrawing();
+        glFinish();
+
+        FrameStats frame = {};
+        frame.ms =
+            std::chrono::duration<double, std::milli>(Clock::now() - start)
+                .count();
+        frame.draw_calls = gl_draw_calls;
+        frame.commands = list.Size();
+        frame.cells = list.Cells();
+        for (auto& info : level.board_rect_cache) {
+          if (info.feedback)
+            frame.copied++;
+          else
+            frame.boards++;
+        }
+        stats.push_back(frame);
+      }
+      Print(name, segment, std::move(stats));
+    }
+  }
+  return true;
+}
+
+// rows go out top down. raw is the pixels as they are, RGBA8 without a header
+static bool WriteFrame(const Readback::Frame& frame,
+                       const char* path,
+                       bool raw,
+                       std::vector<u8>& rows) {
+  u64 stride = (u64)frame.width * 4;
+  auto row = [&](u32 y) {
+    return frame.pixels.data() + (frame.height - 1 - y) * stride;
+  };
+  if (raw) {
+    FILE* file = fopen(path, "wb");
+    if (!file) return false;
+    bool written = true;
+    for (u32 y = 0; y < frame.height; y++)
+      written = fwrite(row(y), stride, 1, file) == 1 && written;
+    return fclose(file) == 0 && written;
+  }
+
+  rows.resize(frame.pixels.size());
+  for (u32 y = 0; y < frame.height; y++)
+    std::copy(row(y), row(y) + stride, rows.data() + y * stride);
+  Image image = {rows.data(),
+                 (int)frame.width,
+                 (int)frame.height,
+                 1,
+                 PIXELFORMAT_UNCOMPRESSED_R8G8B8A8};
+  return ExportImage(image, path);
+}
+
+bool Bench::Capture(std::vector<std::string> args) {
+  std::string name = "mainmenu";
+  optional<float> x, y, zoom;
+  float dive = 1.0f;
+  u32 frames = 1;
+  u32 settle = 8;
+  u32 width = 1280;
+  u32 height = 720;
+  float scale = 1.0f;
+  std::string out = "capture";
+  bool raw = false;
+  bool software = true;
+  for (auto& arg : args) {
+    auto split = arg.find('=');
+    auto key = arg.substr(0, split);
+    auto value = split == std::string::npos ? "" : arg.substr(split + 1);
+    if (key == "x") {
+      x = std::atof(value.c_str());
+    } else if (key == "y") {
+      y = std::atof(value.c_str());
+    } else if (key == "zoom") {
+      zoom = std::atof(value.c_str());
+    } else if (key == "dive") {
+      dive = std::atof(value.c_str());
+    } else if (key == "frames") {
+      frames = std::atoi(value.c_str());
+    } else if (key == "settle") {
+      settle = std::atoi(value.c_str());
+    } else if (key == "width") {
+      width = std::atoi(value.c_str());
+    } else if (key == "height") {
+      height = std::atoi(value.c_str());
+    } else if (key == "scale") {
+      scale = std::atof(value.c_str());
+    } else if (key == "out") {
+      out = value;
+    } else if (key == "raw") {
+      raw = true;
+    } else if (key == "gpu") {
+      software = false;
+    } else if (split == std::string::npos) {
+      name = arg;
+    } else {
+      fprintf(stderr, "unknown parameter %s\n", arg.c_str());
+      return false;
+    }
+  }
+
+  HideWindow(software);
+  auto window = SSAAWindow{width, height, scale, "InfiniSweeper capture"};
+  Unthrottle();
+  auto atlas = LoadAtlas();
+
+  InputFrame input;
+  input.frame_time = frame_time;
+  input.view = window.GetView();
+  input.mouse_position = input.view.window_size / 2;
+  Input::Begin(input);
+
+  Level level;
+  // same seed every run, so captures compare
+  Serializer::Parse(name, level, 0, 1);
+  Serializer::Activate(level);
+  if (x) camera_coord.x = x.value();
+  if (y) camera_coord.y = y.value();
+  if (zoom) camera_zoom = zoom.value();
+
+  auto size = window.GetView().canvas_size;
+  printf("# %s, %s at %.0fx%.0f, RGBA8 rows top down\n",
+         (const char*)glGetString(GL_RENDERER),
+         name.c_str(),
+         size.x,
+         size.y);
+  printf("frame,render_ms,write_ms,path\n");
+
+  // frames are written while later ones render, two behind
+  Readback readback{2};
+  vector<double> render_ms;
+  std::vector<u8> rows;
+  double write_ms = 0;
+  bool written = true;
+  auto write = [&](const Readback::Frame& frame) {
+    auto start = Clock::now();
+    char path[512];
+    snprintf(path,
+             sizeof(path),
+             "%s_%04llu.%s",
+             out.c_str(),
+             (unsigned long long)frame.index,
+             raw ? "rgba" : "png");
+    written = WriteFrame(frame, path, raw, rows) && written;
+    double ms =
+        std::chrono::duration<double, std::milli>(Clock::now() - start)
+            .count();
+    write_ms += ms;
+    printf("%llu,%.3f,%.3f,%s\n",
+           (unsigned long long)frame.index,
+           render_ms[frame.index],
+           ms,
+           path);
+  };
+
+  DrawList list;
+  for (u32 i = 0; i < frames; i++) {
+    auto start = Clock::now();
+    write_ms = 0;
+    if (i > 0) camera_zoom *= dive;
+    CoordTransform::UpdateCameraWorldRect();
+    camera_moved = true;
+
+    level.Tick();
+    list.Clear();
+    level.Draw(list);
+
+    // portal cycles get one level deeper with every pass over the last
+    // one's canvas, like the window's settle frames. Only the last is read
+    u32 passes = list.HasFeedback() ? 1 + settle : 1;
+    for (u32 pass = 0; pass < passes; pass++) {
+      window.BeginDrawing();
+      ClearBackground(Color{40, 48, 65, 255});
+      list.Replay(atlas, window.Feedback(), pass > 0);
+      if (list.HasFeedback()) window.CaptureFeedback();
+      window.BeginUI();
+      if (pass + 1 == passes) {
+        render_ms.push_back(0);
+        readback.Queue(window.CanvasFramebuffer(), size.x, size.y, write);
+      }
+      window.BeginImGui();
+      window.EndDrawing();
+    }
+    // the frame written meanwhile isn't this one's cost
+    render_ms[i] =
+        std::chrono::duration<double, std::milli>(Clock::now() - start)
+            .count() -
+        write_ms;
+  }
+  readback.Flush(write);
+  fflush(stdout);
+  return written;
+}
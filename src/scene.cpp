@@ -6,8 +6,13 @@
 #include <fstream>
 #include <string.h>
 
+#include "input.hpp"
+#include "pack.hpp"
+#include "profiler.hpp"
 #include "rect_util.hpp"
 #include "serializer.hpp"
+#include "snapshot.hpp"
+#include "ssaa_window.hpp"
 #include "transform.hpp"
 
 using std::optional;
@@ -47,47 +52,113 @@ void clamped_to_char(char* in, char digits, int number) {
   snprintf(in, digits + 1, format, number);
 }
 
-Scene::Scene() {
+// "3" of levels.toml or "pack/3", 0 for the levels that aren't numbered
+static int LevelNumber(const std::string& name) {
+  std::string_view pack;
+  u32 number;
+  if (Pack::Split(name, pack, number)) return number;
+  return std::atoi(name.c_str());
+}
+
+Scene::Scene(std::unique_ptr<Level> menu) {
   uis.reserve(32);
 
+  // levels.toml's progress first, then a "<pack> <completed>" line per pack
   auto save = std::ifstream{"save"};
   if (!save.is_open()) {
     completed_levels = 0;
   } else {
     save >> completed_levels;
+    std::string pack;
+    int completed;
+    while (save >> pack >> completed) pack_progress[pack] = completed;
   }
 
-  Serializer::Load("mainmenu", level, completed_levels);
+  // only the pack indexes, levels are read when they're played
+  Pack::Scan();
+
+  if (menu) {
+    level = std::move(*menu);
+    Serializer::Activate(level);
+  } else {
+    Serializer::Load("mainmenu", level, completed_levels);
+  }
 }
 
-void Scene::Tick(SSAAWindow& window) {
+void Scene::Tick() {
+  PROFILE_ZONE("Scene::Tick");
+  PROFILE_LATENCY(Input::Latency(), ticked);
   toolbar.Tick();
   level_clear.Tick();
 
+  damaged = loader.Poll(level);
+
   auto state_prev = level.state;
 
   level.Tick();
 
-  if (state_prev != State::won && level.state == State::won) toolbar.On();
+  if (level.requested_load) {
+    auto& name = level.requested_load.value();
+    loader.Request(name, name == "levelselection" ? completed_levels : 0);
+    level.requested_load = {};
+  }
 
-  if (level.state == State::won) {
-    int level_num = atoi(level.name.c_str());  // 0 on fail
-    if (level_num > completed_levels) {
-      completed_levels = level_num;
+  // packs have no selection screen, P goes through them and continues each
+  // where it was left
+  auto& packs = Pack::All();
+  if (level.name == "levelselection" && !packs.empty() &&
+      Input::IsKeyPressed(KEY_P)) {
+    auto& pack = packs[pack_cursor++ % packs.size()];
+    auto it = pack_progress.find(pack.name);
+    u32 completed = it == pack_progress.end() ? 0 : it->second;
+    loader.Request(Pack::Name(pack.name, std::min(completed + 1, pack.levels)));
+  }
+
+  // autosave numbered levels, finished games can't be resumed
+  if (!level.moves.empty() || level.rewound) {
+    if (LevelNumber(level.name) <= 0) {
+      level.moves.clear();
+      level.rewound = false;
+    } else if (level.state == State::gaming) {
+      Snapshot::Save(level);
+    } else {
+      level.moves.clear();
+      level.rewound = false;
+      if (Snapshot::Exists(level.name)) Snapshot::Discard();
+    }
+  }
 
-      std::ofstream save;
-      save.open("save", std::ofstream::out | std::ofstream::trunc);
-      save << level_num;
+  if (state_prev != State::won && level.state == State::won) {
+    toolbar.On();
+
+    // the next button is the most likely thing to be pressed now
+    int name_next = LevelNumber(level.name) + 1;
+    if (name_next > 1 && name_next <= LastLevel(level.name))
+      loader.Prefetch(Sibling(level.name, name_next));
+  }
+
+  if (level.state == State::won) {
+    int level_num = LevelNumber(level.name);  // 0 on fail
+    if (level_num > Progress(level.name)) {
+      std::string_view pack;
+      u32 number;
+      if (Pack::Split(level.name, pack, number))
+        pack_progress[std::string{pack}] = level_num;
+      else
+        completed_levels = level_num;
+      WriteSave();
     }
   }
 
   AssembleUI();
 
+  auto hover_prev = hover;
+  auto pressed_prev = pressed;
   GetUIHover();
   GetUIPressed();
 
   if (hover.has_value() && hover == pressed) {
-    if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
+    if (Input::IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
       pressed = {};
 
       auto ui = hover.value();
@@ -97,29 +168,32 @@ void Scene::Tick(SSAAWindow& window) {
           toolbar.Off();
           break;
         case UI::previous: {
-          int name_prev = std::atoi(level.name.c_str()) - 1;
-          if (name_prev > 0) Serializer::Load(std::to_string(name_prev), level);
+          int name_prev = LevelNumber(level.name) - 1;
+          if (name_prev > 0) loader.Request(Sibling(level.name, name_prev));
           break;
         }
-        case UI::restart: Serializer::Load(level.name, level); break;
+        case UI::restart:
+          if (Snapshot::Exists(level.name)) Snapshot::Discard();
+          loader.Request(level.name);
+          break;
         case UI::next: {
-          int name_next = std::atoi(level.name.c_str()) + 1;
-          if (name_next <= max_levels)
-            Serializer::Load(std::to_string(name_next), level);
+          int name_next = LevelNumber(level.name) + 1;
+          if (name_next <= LastLevel(level.name))
+            loader.Request(Sibling(level.name, name_next));
           break;
         }
         case UI::play: [[fallthrough]];
         case UI::select:
-          Serializer::Load("levelselection", level, completed_levels);
+          loader.Request("levelselection", completed_levels);
           break;
-        case UI::high: window.SetScale(1.0f); break;
-        case UI::mid: window.SetScale(2.0f); break;
-        case UI::low: window.SetScale(1.5f); break;
+        case UI::high: [[fallthrough]];
+        case UI::mid: [[fallthrough]];
+        case UI::low: quality_cycles++; break;
         case UI::quit: {
           if (level.name == "mainmenu")
             quit = true;
           else
-            Serializer::Load("mainmenu", level);
+            loader.Request("mainmenu");
           break;
         }
         default: break;
@@ -130,11 +204,59 @@ void Scene::Tick(SSAAWindow& window) {
   } else if (hover != pressed) {
     pressed = {};
   }
+
+  // the UI is drawn every frame at native resolution, only the level lives in
+  // the canvas
+  damaged = damaged || level.damaged;
+  animating = toolbar.Running() || level_clear.Running() ||
+              loader.Pending() || hover != hover_prev ||
+              pressed != pressed_prev || level.name == "mainmenu";
+  timer_wait = level.started && level.state == State::gaming
+                   ? std::floor(level.time) + 1.0 - level.time
+                   : 0.0;
+}
+
+int Scene::Progress(const std::string& name) const {
+  std::string_view pack;
+  u32 number;
+  if (!Pack::Split(name, pack, number)) return completed_levels;
+  auto it = pack_progress.find(std::string{pack});
+  return it == pack_progress.end() ? 0 : it->second;
+}
+
+int Scene::LastLevel(const std::string& name) const {
+  std::string_view pack;
+  u32 number;
+  if (!Pack::Split(name, pack, number)) return max_levels;
+  return Pack::Count(pack);
+}
+
+std::string Scene::Sibling(const std::string& name, int number) const {
+  std::string_view pack;
+  u32 current;
+  if (!Pack::Split(name, pack, current)) return std::to_string(number);
+  return Pack::Name(pack, number);
 }
 
-void Scene::Draw(AtlasManager& atlas) {
-  level.Draw(atlas);
-  DrawUI(atlas);
+void Scene::WriteSave() const {
+  std::ofstream save;
+  save.open("save", std::ofstream::out | std::ofstream::trunc);
+  save << completed_levels << "\n";
+  for (auto& [pack, completed] : pack_progress)
+    save << pack << " " << completed << "\n";
+}
+
+void Scene::Draw(DrawList& list) {
+  level.Draw(list);
+}
+
+// auto quality has no icon of its own, it shows the closest fixed one tinted
+static UIInfo QualityUI(rl::Rect rect) {
+  static const rl::Color blue = {0x59, 0xe2, 0xff, 0xff};
+  UI quality = UI::high;
+  if (ssaa_scale < 1.75f) quality = UI::mid;
+  if (ssaa_scale < 1.25f) quality = UI::low;
+  return {quality, rect, true, true, ssaa_auto ? blue : (rl::Color)WHITE};
 }
 
 void Scene::AssembleUI() {
@@ -148,43 +270,41 @@ void Scene::AssembleUI() {
     // menu
     uis.push_back({UI::menu, Square(0.01, 0.01, 0.05)});
 
-    int num = std::atoi(level.name.c_str());
+    int num = LevelNumber(level.name);
+    auto depth = level.EndlessDepth();
     // prev
     float y = -0.05 + BounceBack(toolbar.t, 10. / 30, 45. / 30, 5. / 30) * 0.06;
     bool enabled = num > 1;
     uis.push_back({UI::previous, Square(0.06, y, 0.05), enabled});
 
     // restart
-    enabled = num > 0;
+    enabled = num > 0 || depth;
     y = -0.05 + BounceBack(toolbar.t, 13. / 30, 42. / 30, 5. / 30) * 0.06;
     uis.push_back({UI::restart, Square(0.11, y, 0.05), enabled});
 
     // next
-    enabled = num < max_levels && num > 0 && num < completed_levels + 1;
+    enabled = num < LastLevel(level.name) && num > 0 &&
+              num < Progress(level.name) + 1;
     y = -0.05 + BounceBack(toolbar.t, 16. / 30, 39. / 30, 5. / 30) * 0.06;
     uis.push_back({UI::next, Square(0.16, y, 0.05), enabled});
 
     // select
-    enabled = num > 0;
+    enabled = num > 0 || depth;
     y = -0.05 + BounceBack(toolbar.t, 19. / 30, 36. / 30, 5. / 30) * 0.06;
     uis.push_back({UI::select, Square(0.21, y, 0.05), enabled});
 
-    UI quality;
-    if (ssaa_scale == 1.0f) quality = UI::low;
-    if (ssaa_scale == 1.5f) quality = UI::mid;
-    if (ssaa_scale == 2.0f) quality = UI::high;
     y = -0.05 + BounceBack(toolbar.t, 22. / 30, 33. / 30, 5. / 30) * 0.06;
-    uis.push_back({quality, Square(0.26, y, 0.05)});
+    uis.push_back(QualityUI(Square(0.26, y, 0.05)));
 
     // quit
     y = -0.05 + BounceBack(toolbar.t, 25. / 30, 30. / 30, 5. / 30) * 0.06;
     uis.push_back({UI::quit, Square(0.31, y, 0.05)});
 
-    if (num > 0) {
-      // game stats
+    if (num > 0 || depth) {
+      // game stats, endless mode shows how deep the player is instead
       uis.push_back({UI::none, rl::Rect{0.58, 0, 0.42, 0.07}, false, false});
       uis.push_back({UI::level, Square(0.59, 0.01, 0.05), true, false});
-      clamped_to_char(numbers, 2, num);
+      clamped_to_char(numbers, 2, depth ? (int)depth.value() : num);
 
       uis.push_back({UI::time, Square(0.715, 0.01, 0.05), true, false});
       clamped_to_char(&numbers[2], 3, level.time);
@@ -205,58 +325,71 @@ void Scene::AssembleUI() {
     uis.push_back({UI::play, RectUtil::Fit(1, rect)});
 
     rect.x += 1.0f / 9.0f;
-    UI quality;
-    if (ssaa_scale == 1.0f) quality = UI::low;
-    if (ssaa_scale == 1.5f) quality = UI::mid;
-    if (ssaa_scale == 2.0f) quality = UI::high;
-    uis.push_back({quality, RectUtil::Fit(1, rect)});
+    uis.push_back(QualityUI(RectUtil::Fit(1, rect)));
 
     rect.x += 1.0f / 9.0f;
     uis.push_back({UI::quit, RectUtil::Fit(1, rect)});
   }
 }
 
-void Scene::DrawUI(AtlasManager& atlas) {
+void Scene::DrawUI(DrawList& list) {
   const rl::Color grey = {0, 0, 0, 100};
   const rl::Color transp = {127, 127, 127, 192};
   for (auto& ui : uis) {
     if (ui.index == UI::none)
-      CoordTransform::ScreenToPixel(ui.rect).Draw(grey);
+      list.DrawRect(CoordTransform::ScreenToPixel(ui.rect), grey);
     else if (ui.enabled == false)
-      atlas.DrawUI(ui.index, ui.rect, transp);
+      list.DrawUI(ui.index, ui.rect, transp);
     else if (ui.clickable == false)
-      atlas.DrawUI(ui.index, ui.rect, WHITE);
+      list.DrawUI(ui.index, ui.rect, ui.tint);
     else if (ui.index == hover && ui.index == pressed) {
       auto smaller_rect = rl::Rect{ui.rect.x + ui.rect.width * .05f,
                                    ui.rect.y + ui.rect.height * .05f,
                                    ui.rect.width * 0.9f,
                                    ui.rect.height * 0.9f};
-      atlas.DrawUI(ui.index, smaller_rect, WHITE);
+      list.DrawUI(ui.index, smaller_rect, ui.tint);
     } else if (ui.index == hover) {
       auto bigger_rect = rl::Rect{ui.rect.x - ui.rect.width * .05f,
                                   ui.rect.y - ui.rect.height * .05f,
                                   ui.rect.width * 1.1f,
                                   ui.rect.height * 1.1f};
-      atlas.DrawUI(ui.index, bigger_rect, WHITE);
+      list.DrawUI(ui.index, bigger_rect, ui.tint);
     } else
-      atlas.DrawUI(ui.index, ui.rect, WHITE);
+      list.DrawUI(ui.index, ui.rect, ui.tint);
   }
 
   if (level.name == "mainmenu") {
-    atlas.DrawLogo(RectUtil::Fit(
+    list.DrawLogo(RectUtil::Fit(
         1, {0.f, 0.f, 1.0f / 3.0f, inverse_aspect_ratio * 0.75f}));
   }
 
-  if (std::atoi(level.name.c_str()) > 0) {
+  if (LevelNumber(level.name) > 0 || level.EndlessDepth()) {
     const float loc[8] = {0.64, 0.665, 0.765, 0.79, 0.815, 0.915, 0.94, 0.965};
     for (int i = 0; i < 8; i++) {
       char& n = numbers[i];
       const float& x = loc[i];
       rl::Color c = (n == ' ') ? transp : (rl::Color)WHITE;
       if (n == ' ') n = '0';
-      atlas.DrawUI(n, rl::Rect{x, 0.01, 0.025, 0.05}, c);
+      list.DrawUI(n, rl::Rect{x, 0.01, 0.025, 0.05}, c);
     }
   }
+
+  if (loader.ShowIndicator()) DrawLoading(list);
+}
+
+void Scene::DrawLoading(DrawList& list) {
+  static const rl::Color white_transp = {255, 255, 255, 192};
+  auto center = CoordTransform::ScreenToPixel(
+      rl::Vector2{0.96f, inverse_aspect_ratio - 0.04f});
+  float radius = canvas_size.x * 0.015f;
+  float angle = std::fmod(Input::GetTime() * 360.0f, 360.0f);
+  list.DrawRing(center,
+                radius * 0.6f,
+                radius,
+                angle,
+                angle + 270.0f,
+                24,
+                white_transp);
 }
 
 void Scene::GetUIHover() {
@@ -264,7 +397,7 @@ void Scene::GetUIHover() {
   hover = {};
 
   for (auto& ui : uis) {
-    rl::Vector2 mouse = (rl::Vector2)GetMousePosition() / window_size.x;
+    rl::Vector2 mouse = (rl::Vector2)Input::GetMousePosition() / window_size.x;
     if (ui.rect.CheckCollision(mouse)) {
       mouse_on_ui = true;
       if (ui.clickable && ui.enabled) {
@@ -275,10 +408,10 @@ void Scene::GetUIHover() {
 }
 
 void Scene::GetUIPressed() {
-  if (!IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) return;
+  if (!Input::IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) return;
 
   for (auto& ui : uis) {
-    rl::Vector2 mouse = (rl::Vector2)GetMousePosition() / window_size.x;
+    rl::Vector2 mouse = (rl::Vector2)Input::GetMousePosition() / window_size.x;
     if (ui.rect.CheckCollision(mouse)) {
       if (ui.clickable && ui.enabled) {
         pressed = ui.index;
@@ -291,7 +424,7 @@ void Scene::GetUIPressed() {
 void Animation::Tick() {
   if (t == 1.0f || t == 0.0f) return;
 
-  float future = t + GetFrameTime() / duration;
+  float future = t + Input::GetFrameTime() / duration;
   if (t < 1.0f && future > 1.0f)
     t = 1.0f;
   else if (future > 2.0f)
@@ -1,12 +1,14 @@
 #pragma once
 
+#include <map>
+#include <memory>
 #include <optional>
 #include <string>
 
-#include "atlas.hpp"
+#include "draw_list.hpp"
+#include "level_loader.hpp"
 #include "logic.hpp"
 #include "rl.hpp"
-#include "ssaa_window.hpp"
 
 extern int max_levels;
 extern bool mouse_on_ui;  // shouldn't have mouse button input when this is true
@@ -17,6 +19,7 @@ struct UIInfo {
   rl::Rect rect;
   bool enabled = true;    // for when prev/next level is disabled
   bool clickable = true;  // for timer etc
+  rl::Color tint = WHITE;
 };
 
 class Animation {
@@ -27,17 +30,41 @@ class Animation {
   void Tick();
   void On();
   void Off();
+  inline bool Running() { return t != 0.0f && t != 1.0f; };
 };
 
 class Scene {
  public:
-  Scene();
-  void Tick(SSAAWindow& window);
-  void Draw(AtlasManager& atlas);
+  // menu is the main menu, already parsed on another thread. Parsed right
+  // here when null
+  explicit Scene(std::unique_ptr<Level> menu = nullptr);
+  void Tick();
+  // level only, replayed into the supersampled canvas
+  void Draw(DrawList& list);
+  // replayed after SSAAWindow::BeginUI, at native resolution
+  void DrawUI(DrawList& list);
+
+  // read only, for the debug window
+  inline const Level& CurrentLevel() const { return level; };
+
+  // the level or UI looks different than last tick, camera not included
+  bool damaged = true;
+  // something on screen changes over time even without input (animations,
+  // loading), so the frame loop can't sleep until the next event
+  bool animating = false;
+  // seconds until the timer shows the next one, 0 when it isn't running. It
+  // only needs a frame then, not every frame
+  double timer_wait = 0.0;
+  // times the quality button was clicked. The window belongs to whoever
+  // draws, it applies the difference
+  u32 quality_cycles = 0;
 
  private:
-  int completed_levels;
+  int completed_levels;  // of levels.toml
+  std::map<std::string, int> pack_progress;
+  u32 pack_cursor = 0;  // the pack P goes to next
   Level level;
+  LevelLoader loader;
   Animation toolbar = {0.0f, 0.35f};
   Animation level_clear;
 
@@ -45,8 +72,14 @@ class Scene {
   std::optional<UI> pressed;
   std::vector<UIInfo> uis;  // immediate mode, destroy every tick and rebuild
   char numbers[9];          //\0
+  // these go by the level's pack, or levels.toml when it isn't in one
+  int Progress(const std::string& name) const;
+  int LastLevel(const std::string& name) const;
+  std::string Sibling(const std::string& name, int number) const;
+  void WriteSave() const;
+
   void AssembleUI();
-  void DrawUI(AtlasManager& atlas);
+  void DrawLoading(DrawList& list);
 
   void GetUIHover();
   void GetUIPressed();
@@ -2,24 +2,130 @@
 
 #include <toml.h>
 
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <filesystem>
 #include <iostream>
 #include <optional>
-#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "logic.hpp"
+#include "pack.hpp"
 #include "scene.hpp"  //load max levels into scene manager
 #include "transform.hpp"
 
 using std::optional;
 using std::vector;
 
+// one cell of a text board. Anything unknown is void
+static optional<Cell> ParseToken(char a, char b) {
+  if (a == '[' && b == ']') return Cell{};
+  if (a == '<' && b == '>') return Cell{.covered = false};
+  if (a == 'm' && b == 'm') return Cell{.mine = true};
+  if (a == 'f' && b == 'f') return Cell{.mine = true, .flagged = true};
+  if (a == 's' && b == 'f') return Cell{.safe = true};
+  // two digits override the number shown, for level selection
+  if (a >= '0' && a <= '9' && b >= '0' && b <= '9')
+    return Cell{.covered = false, .number = (u32)((a - '0') * 10 + b - '0')};
+  return {};
+}
+
+// f(y, line) for every line, split the way getline would. Views into text
+template <class F>
+static void ForEachLine(std::string_view text, F&& f) {
+  for (u32 y = 0; !text.empty(); y++) {
+    size_t end = text.find('\n');
+    f(y, text.substr(0, end));
+    if (end == std::string_view::npos) break;
+    text.remove_prefix(end + 1);
+  }
+}
+
+// two characters a cell, walked in place. Returns the mines in it
+static int ParseText(std::string_view text, Board& board) {
+  // the storage is picked from the size, so the size comes first
+  u32 width = 0;
+  u32 height = 0;
+  ForEachLine(text, [&](u32 y, std::string_view line) {
+    if (y == 0) width = line.length() / 2;
+    height++;
+  });
+  board = Board{width, height};
+
+  int mines = 0;
+  ForEachLine(text, [&](u32 y, std::string_view line) {
+    u32 end = std::min<u32>(width, line.length() / 2);
+    for (u32 x = 0; x < end; x++) {
+      auto cell = ParseToken(line[2 * x], line[2 * x + 1]);
+      if (!cell) continue;  // void is what the board starts with
+      if (cell->mine) mines++;
+      board.Set(x, y, cell);
+    }
+  });
+  return mines;
+}
+
+// a pixel a cell, for boards too big to type out. Colors are exact, anything
+// else is void:
+//   white [] cell, grey <> open, red mm mine, blue ff flagged mine,
+//   green sf safe, black or transparent void
+static int ParseImage(const std::string& path, Board& board) {
+  auto image = rl::Image{path};  // throws when it can't be loaded
+  image.Format(PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+  board = Board{(u32)image.width, (u32)image.height};
+
+  auto pixels = (const Color*)image.data;
+  int mines = 0;
+  for (i32 y = 0; y < image.height; y++) {
+    for (i32 x = 0; x < image.width; x++) {
+      auto p = pixels[y * image.width + x];
+      if (p.a == 0) continue;
+      u32 rgb = (p.r << 16) | (p.g << 8) | p.b;
+      optional<Cell> cell;
+      switch (rgb) {
+        case 0xffffff: cell = Cell{}; break;
+        case 0x808080: cell = Cell{.covered = false}; break;
+        case 0xff0000: cell = Cell{.mine = true}; break;
+        case 0x0000ff: cell = Cell{.mine = true, .flagged = true}; break;
+        case 0x00ff00: cell = Cell{.safe = true}; break;
+        default: continue;
+      }
+      if (cell->mine) mines++;
+      board.Set(x, y, cell);
+    }
+  }
+  return mines;
+}
+
+u64 Serializer::NewSeed() {
+  // splitmix64 steps over one shared atomic state, so any thread can draw.
+  // Seeded once from the clock
+  static std::atomic<u64> state =
+      std::chrono::steady_clock::now().time_since_epoch().count() ^
+      (u64)time(nullptr) << 32;
+  auto rng = Rng{state.fetch_add(0x9e3779b97f4a7c15ull)};
+  return rng.Next();
+}
+
 void Serializer::Load(std::string name, Level& level, int completed_levels) {
+  Parse(name, level, completed_levels, NewSeed());
+  Activate(level);
+}
+
+void Serializer::Parse(std::string name,
+                       Level& level,
+                       int completed_levels,
+                       u64 seed,
+                       std::optional<std::string_view> text) {
   level.boards.clear();
   level.boards.reserve(256);
   level.portals.clear();
   level.board_rect_cache.clear();
+  level.drawn_view = {};
 
   level.name = name;
   level.mine_left = 0;
@@ -29,61 +135,73 @@ void Serializer::Load(std::string name, Level& level, int completed_levels) {
   level.mouse_over = {};
   level.mouse_over_last_frame = {};
   level.root_board = 0;
+  level.requested_load = {};
+  level.moves.clear();
+  level.resume_camera = {};
+  level.seed = seed;
+  level.rng = Rng{seed};
+  level.endless = {};
 
-  // load the file every time. Hot reloading easier to design maps
-  auto levels = toml::parse_file("levels.toml");
-  auto level_node = levels[name];
+  // load the file every time. Hot reloading easier to design maps. A pack
+  // level is parsed alone, its table is the only one in the text
+  toml::table levels;
+  std::string key = name;
+  std::string_view pack;
+  u32 number;
+  std::optional<std::string> pack_text;
+  if (!text && Pack::Split(name, pack, number)) {
+    pack_text = Pack::ReadLevel(name);
+    // caught by the loader like a typo in levels.toml
+    if (!pack_text) throw std::runtime_error{"not in its pack"};
+    text = pack_text.value();
+  }
+  if (text) {
+    levels = toml::parse(text.value(), name);
+    if (!levels.empty()) key = levels.begin()->first.str();
+  } else {
+    levels = toml::parse_file("levels.toml");
+  }
+  auto level_node = levels[key];
+
+  // boards get generated as the player goes, the table only tweaks the shape
+  if (name == "endless") {
+    EndlessParams params;
+    params.width = level_node["width"].value_or(params.width);
+    params.height = level_node["height"].value_or(params.height);
+    params.portal_x = level_node["x"].value_or(params.portal_x);
+    params.portal_y = level_node["y"].value_or(params.portal_y);
+    params.portal_w = level_node["w"].value_or(params.portal_w);
+    params.portal_h = level_node["h"].value_or(params.portal_h);
+    params.density = level_node["density"].value_or(params.density);
+    Endless::Build(level, params);
+    return;
+  }
 
   // boards
+  // image paths are relative to the file the level came from
+  auto folder = std::filesystem::path{Pack::Folder(name)};
   vector<optional<int>> target_mine;
   optional<int> total_mine = level_node["totalmine"].value<int>();
 
-  for (int i = 0; level_node["board" + std::to_string(i)].is_string(); i++) {
-    auto board_str = std::stringstream(
-        level_node["board" + std::to_string(i)].value<std::string>().value());
-    level.boards.emplace_back();
-    auto& board = level.boards[i];
-    target_mine.push_back(
-        level_node["board" + std::to_string(i) + "mine"].value<int>());
-
-    int y = 0;
-    int board_mine = 0;
-    for (std::string line; std::getline(board_str, line, '\n'); y++) {
-      board.width = line.length() / 2;
-      for (int x = 0; x < board.width; x++) {
-        char token[3] = {line[2 * x], line[2 * x + 1], '\0'};
-
-        if (strcmp(token, "[]") == 0) {
-          board.cells.push_back(Cell{});
-        } else if (strcmp(token, "<>") == 0) {
-          board.cells.push_back(Cell{.covered = false});
-        } else if (strcmp(token, "mm") == 0) {
-          board.cells.push_back(Cell{.mine = true});
-          board_mine++;
-        } else if (strcmp(token, "ff") == 0) {
-          board.cells.push_back(Cell{.mine = true, .flagged = true});
-          board_mine++;
-        } else if (strcmp(token, "sf") == 0) {
-          board.cells.push_back(Cell{.safe = true});
-        } else if ((token[0] >= '0' && token[0] <= '9') &&
-                   (token[1] >= '0' && token[1] <= '9')) {
-          int number = (token[0] - '0') * 10 + (token[1] - '0');
-          // if(number - level_completed <= 1)
-          board.cells.push_back(Cell{.covered = false, .number = (u32)number});
-          // else board.cells.push_back(Cell{});
-        } else {
-          board.cells.push_back({});
-        }
-      }
-    }
-    board.height = y;
+  for (int i = 0;; i++) {
+    auto key = "board" + std::to_string(i);
+    // a view into the parsed table, the text isn't copied again
+    auto text = level_node[key].value<std::string_view>();
+    auto image = level_node[key + "image"].value<std::string>();
+    if (!text && !image) break;
+
+    auto& board = level.boards.emplace_back();
+    target_mine.push_back(level_node[key + "mine"].value<int>());
+    int board_mine =
+        image ? ParseImage((folder / image.value()).string(), board)
+              : ParseText(text.value(), board);
 
     while (board_mine < target_mine[i].value_or(0)) {
-      int x = GetRandomValue(0, board.width - 1);   // both sides inclusive
-      int y = GetRandomValue(0, board.height - 1);  // both sides inclusive
-      auto& optional_cell = board.Get(x, y);
+      int x = level.rng.Range(0, board.width - 1);   // both sides inclusive
+      int y = level.rng.Range(0, board.height - 1);  // both sides inclusive
+      auto* optional_cell = board.Get(x, y);
       if (!optional_cell) continue;
-      auto& cell = optional_cell.value();
+      auto& cell = *optional_cell;
 
       if (!cell.mine && !cell.safe && cell.covered) {
         cell.mine = true;
@@ -100,14 +218,9 @@ void Serializer::Load(std::string name, Level& level, int completed_levels) {
     int current_total_mine = 0;
 
     for (int i = 0; i < board_amount; i++) {
-      auto& board = level.boards[i];
-      for (i32 x = 0; x < board.width; x++) {
-        for (i32 y = 0; y < board.height; y++) {
-          if (!board.Get(x, y)) continue;
-          if (!board.Get(x, y).value().mine) continue;
-          current_total_mine++;
-        }
-      }
+      level.boards[i].ForEachCell([&](i32, i32, Cell& cell) {
+        if (cell.mine) current_total_mine++;
+      });
     }
 
     for (int i = 0; i < board_amount; i++) {
@@ -134,7 +247,7 @@ void Serializer::Load(std::string name, Level& level, int completed_levels) {
     }
 
     while (current_total_mine < total_mine.value()) {
-      int index = GetRandomValue(0, total_cell_amount - 1);
+      int index = level.rng.Range(0, total_cell_amount - 1);
       int i = 0;
       while (index >= 0 && i < cell_amount.size()) {
         index -= cell_amount[i];
@@ -143,9 +256,10 @@ void Serializer::Load(std::string name, Level& level, int completed_levels) {
       // go back one step
       i--;
       index += cell_amount[i];
-      auto& optional_cell = board_to_add[i]->cells[index];
+      auto& board = *board_to_add[i];
+      auto* optional_cell = board.Get(index % board.width, index / board.width);
       if (!optional_cell) continue;
-      auto& cell = optional_cell.value();
+      auto& cell = *optional_cell;
 
       if (!cell.mine && !cell.safe && cell.covered) {
         cell.mine = true;
@@ -154,13 +268,9 @@ void Serializer::Load(std::string name, Level& level, int completed_levels) {
     }
   } else {
     for (auto& board : level.boards) {
-      for (i32 x = 0; x < board.width; x++) {
-        for (i32 y = 0; y < board.height; y++) {
-          if (board.Get(x, y) && board.Get(x, y).value().mine) {
-            level.mine_left++;
-          }
-        }
-      }
+      board.ForEachCell([&](i32, i32, Cell& cell) {
+        if (cell.mine) level.mine_left++;
+      });
     }
   }
 
@@ -184,28 +294,37 @@ void Serializer::Load(std::string name, Level& level, int completed_levels) {
     });
   }
 
-  level.CalculateNeighbors();
+  level.ResetNeighbors();
   level.CalculateMineNumbers();
 
   if (name == "levelselection") {
     for (auto& board : level.boards) {
-      for (i32 x = 0; x < board.width; x++) {
-        for (i32 y = 0; y < board.height; y++) {
-          if (board.Get(x, y)) {
-            if (max_levels < board.Get(x, y).value().number)
-              max_levels = board.Get(x, y).value().number;
-            if (board.Get(x, y).value().number - 1 > completed_levels) {
-              board.Get(x, y).value().covered = true;
-            }
-          }
-        }
-      }
+      board.ForEachCell([&](i32, i32, Cell& cell) {
+        if (cell.number - 1 > completed_levels) cell.covered = true;
+      });
+    }
+  }
+}
+
+void Serializer::Activate(Level& level) {
+  // max_levels is shared with the scene, so it's only updated here instead of
+  // in Parse
+  if (level.name == "levelselection") {
+    for (auto& board : level.boards) {
+      board.ForEachCell([](i32, i32, Cell& cell) {
+        if (max_levels < cell.number) max_levels = cell.number;
+      });
     }
   }
 
   auto& root_board = level.boards[level.root_board];
 
-  if (name == "mainmenu") {
+  if (level.resume_camera) {
+    // root_board came with the snapshot, camera is relative to it
+    camera_coord = level.resume_camera->first;
+    camera_zoom = level.resume_camera->second;
+    level.resume_camera = {};
+  } else if (level.name == "mainmenu") {
     camera_coord.x = 4.0f;
     camera_coord.y = 4.5f;
     camera_zoom = 1.0f / 3.0f;
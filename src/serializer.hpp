@@ -1,9 +1,30 @@
 #pragma once
 
+#include <optional>
 #include <string>
+#include <string_view>
+
+#include "fixed_size_int.hpp"
 
 class Level;
 namespace Serializer {
+// safe from any thread, never draws from raylib's rand()
+u64 NewSeed();
+
+// builds the level from levels.toml, or its pack. Doesn't touch the camera or
+// any other global, so it's safe to run on the loading thread. text is the
+// level's table instead, for levels that only exist in memory
+void Parse(std::string name,
+           Level& level,
+           int completed_levels,
+           u64 seed,
+           std::optional<std::string_view> text = {});
+
+// simulation thread only, publishes a parsed level: resets the camera onto it
+// and updates max_levels for level selection
+void Activate(Level& level);
+
+// Parse + Activate in one go, blocks until done
 // completed_levels is useful for level selection menu
 void Load(std::string name, Level& level, int completed_levels = 0);
 };  // namespace Serializer
@@ -0,0 +1,91 @@
+#include "simulation.hpp"
+
+#include <algorithm>
+
+#include "profiler.hpp"
+#include "ssaa_window.hpp"
+#include "transform.hpp"
+
+static RenderSnapshot::ArenaStats Stats(const Arena& arena) {
+  return {arena.allocations, arena.bytes, arena.Blocks(), arena.BlockBytes()};
+}
+
+Simulation::Simulation(const InputFrame& first,
+                       bool threaded,
+                       std::unique_ptr<Level> menu) {
+  Input::Begin(first);
+  scene = std::make_unique<Scene>(std::move(menu));
+  if (threaded) worker = std::thread(&Simulation::Work, this);
+}
+
+Simulation::~Simulation() {
+  if (!worker.joinable()) return;
+  input.Stop();
+  worker.join();
+}
+
+void Simulation::Submit(const InputFrame& frame) {
+  if (worker.joinable())
+    input.Push(frame);
+  else
+    Step(frame);
+}
+
+const RenderSnapshot& Simulation::Latest() {
+  snapshots.Update();
+  return snapshots.Front();
+}
+
+void Simulation::Work() {
+  while (auto frame = input.Pop()) Step(frame.value());
+}
+
+void Simulation::Step(const InputFrame& frame) {
+  PROFILE_ZONE("Simulation::Step");
+  Input::Begin(frame);
+  CoordTransform::UpdateCamera();
+  scene->Tick();
+
+  auto& snapshot = snapshots.Back();
+  snapshot.level.Reserve(level_peak);
+  snapshot.ui.Reserve(ui_peak);
+  if (scene->damaged || camera_moved || resized || level_version == 0) {
+    PROFILE_ZONE("Scene::Draw");
+    snapshot.level.Clear();
+    scene->Draw(snapshot.level);
+    level_version++;
+    level_slot = snapshots.BackIndex();
+  } else if (snapshot.level_version != level_version) {
+    // nothing changed, but this slot still has a list from a while ago. The
+    // window may be replaying the newest one right now, copying only reads
+    snapshot.level = snapshots.Slot(level_slot).level;
+  }
+  snapshot.level_version = level_version;
+
+  snapshot.ui.Clear();
+  scene->DrawUI(snapshot.ui);
+  level_peak = std::max(level_peak, snapshot.level.Size());
+  ui_peak = std::max(ui_peak, snapshot.ui.Size());
+  PROFILE_LATENCY(Input::Latency(), drawn);
+  snapshot.latency = Input::Latency();
+
+  snapshot.animating = scene->animating;
+  snapshot.timer_wake_at =
+      scene->timer_wait > 0.0 ? frame.time + scene->timer_wait : 0.0;
+  snapshot.quit = quit;
+  snapshot.quality_cycles = scene->quality_cycles;
+
+  auto& level = scene->CurrentLevel();
+  snapshot.camera_coord = camera_coord;
+  snapshot.camera_zoom = camera_zoom;
+  snapshot.camera_world_rect = camera_world_rect;
+  snapshot.mouse_world = CoordTransform::PixelToWorld(
+      (rl::Vector2)Input::GetMousePosition() * ssaa_scale);
+  snapshot.level_arena = Stats(level.LevelArena());
+  snapshot.frame_arena = Stats(level.FrameArena());
+  // the other slots keep whatever they measured last, only read while the
+  // panel is open anyway
+  if (frame.measure_memory) level.MeasureMemory(snapshot.level_memory);
+
+  snapshots.Publish();
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <memory>
+#include <thread>
+
+#include "draw_list.hpp"
+#include "fixed_size_int.hpp"
+#include "input.hpp"
+#include "rl.hpp"
+#include "scene.hpp"
+#include "triple_buffer.hpp"
+
+// everything the window needs from one tick, never changed once published
+struct RenderSnapshot {
+  DrawList level;         // into the canvas
+  u64 level_version = 0;  // changes whenever level does
+  DrawList ui;            // over the canvas, at native resolution
+  bool animating = true;
+  // GetTime() the level timer shows its next second at, 0 when it's stopped
+  double timer_wake_at = 0.0;
+  bool quit = false;
+  u32 quality_cycles = 0;
+  InputLatency latency;  // of the input it was ticked with, presented unset
+
+  // for the debug window, the simulation's own state isn't safe to look at
+  struct ArenaStats {
+    u64 allocations = 0;
+    u64 bytes = 0;
+    u64 blocks = 0;
+    u64 block_bytes = 0;
+  };
+  rl::Vector2 camera_coord = {0.0f, 0.0f};
+  float camera_zoom = 0.0f;
+  rl::Rect camera_world_rect = {0.0f, 0.0f, 0.0f, 0.0f};
+  rl::Vector2 mouse_world = {0.0f, 0.0f};
+  ArenaStats level_arena;
+  ArenaStats frame_arena;
+  LevelMemory level_memory;
+};
+
+// owns the scene and ticks it once per input frame. Single threaded it ticks
+// right in Submit. Threaded, a worker waits on the input queue and the window
+// thread only ever sees finished snapshots, so a slow tick costs the player
+// responsiveness but never a dropped frame
+class Simulation {
+ public:
+  // first sets up the globals the scene loads the main menu with, menu is
+  // handed to the scene
+  Simulation(const InputFrame& first,
+             bool threaded,
+             std::unique_ptr<Level> menu = nullptr);
+  ~Simulation();
+
+  // window thread, once per frame
+  void Submit(const InputFrame& frame);
+  // window thread, newest published snapshot
+  const RenderSnapshot& Latest();
+
+  inline bool Threaded() const { return worker.joinable(); };
+
+ private:
+  void Step(const InputFrame& frame);
+  void Work();
+
+  std::unique_ptr<Scene> scene;
+  InputQueue input;
+  TripleBuffer<RenderSnapshot> snapshots;
+  u64 level_version = 0;
+  u8 level_slot = 0;  // where the newest level list was recorded
+  // the longest lists so far. Each slot grows on its own, reserving this in
+  // all of them keeps a slot that missed the busiest frame from growing later
+  size_t level_peak = 0;
+  size_t ui_peak = 0;
+
+  std::thread worker;  // declared last, starts after everything above exists
+};
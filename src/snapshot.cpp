@@ -0,0 +1,302 @@
+#include "snapshot.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+
+#include "logic.hpp"
+#include "transform.hpp"
+
+static const char* snapshot_path = "autosave";
+static const char* journal_path = "autosave.journal";
+
+static constexpr u32 snapshot_magic = 0x56535349;  // "ISSV"
+static constexpr u32 journal_magic = 0x4e4a5349;   // "ISJN"
+static constexpr u32 version = 4;
+
+// a move costs 17 bytes, rewrite the snapshot every so often so resuming
+// doesn't have to replay the whole game
+static constexpr u32 max_journal_moves = 512;
+
+// anything bigger is a corrupt file, not a board
+static constexpr u32 max_board_side = 1 << 16;
+
+// simulation thread only
+static std::optional<u64> saved_seed;
+
+template <typename T>
+static void Put(std::ofstream& file, T value) {
+  file.write((const char*)&value, sizeof(T));
+}
+
+template <typename T>
+static T Take(std::ifstream& file) {
+  T value = {};
+  file.read((char*)&value, sizeof(T));
+  return value;
+}
+
+// 7 bits a byte, low first, the high bit says another one follows. Numbers
+// are almost always below 128 but portals can push one past any fixed width
+static void PutVarint(std::ofstream& file, u32 value) {
+  while (value >= 0x80) {
+    Put<u8>(file, (value & 0x7f) | 0x80);
+    value >>= 7;
+  }
+  Put<u8>(file, value);
+}
+
+static u32 TakeVarint(std::ifstream& file) {
+  u32 value = 0;
+  for (u32 shift = 0; shift < 32 && file; shift += 7) {
+    u8 byte = Take<u8>(file);
+    value |= (u32)(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) break;
+  }
+  return value;
+}
+
+// header shared by Write, Read and Exists: magic, version, name, seed
+static bool ReadHeader(std::ifstream& file, std::string& name, u64& seed) {
+  if (Take<u32>(file) != snapshot_magic) return false;
+  if (Take<u32>(file) != version) return false;
+  u32 name_length = Take<u32>(file);
+  if (!file || name_length > 256) return false;
+  name.resize(name_length);
+  file.read(name.data(), name.size());
+  seed = Take<u64>(file);
+  return (bool)file;
+}
+
+void Snapshot::Save(Level& level) {
+  if (level.moves.empty() && !level.rewound) return;
+
+  if (!saved_seed) {
+    auto file = std::ifstream{snapshot_path, std::ios::binary};
+    std::string name;
+    u64 seed;
+    saved_seed = ReadHeader(file, name, seed) ? seed : 0;
+  }
+
+  if (saved_seed != level.seed ||
+      level.journaled_moves >= max_journal_moves || level.rewound) {
+    // keeping the moves tries again next time, the old snapshot and
+    // journal still agree
+    if (!Write(level)) return;
+    level.moves.clear();
+    level.rewound = false;
+    return;
+  }
+
+  auto journal = std::ofstream{journal_path, std::ios::binary | std::ios::app};
+  for (auto& move : level.moves) {
+    Put<u8>(journal, (u8)move.type);
+    Put<u32>(journal, move.id.board_index);
+    Put<i32>(journal, move.id.x);
+    Put<i32>(journal, move.id.y);
+    Put<float>(journal, move.time);
+  }
+  level.journaled_moves += level.moves.size();
+  level.moves.clear();
+}
+
+bool Snapshot::Write(Level& level) {
+  // a crash halfway through would leave neither game, so the old one stays
+  // until this one is complete
+  auto temp_path = std::string{snapshot_path} + ".tmp";
+  auto file = std::ofstream{temp_path, std::ios::binary | std::ios::trunc};
+  Put<u32>(file, snapshot_magic);
+  Put<u32>(file, version);
+  Put<u32>(file, level.name.size());
+  file.write(level.name.data(), level.name.size());
+  Put<u64>(file, level.seed);
+
+  Put<u64>(file, level.rng.state);
+  Put<float>(file, level.time);
+  Put<i32>(file, level.mine_left);
+  Put<u8>(file, (u8)level.state);
+  Put<u8>(file, level.started);
+  Put<u32>(file, level.root_board);
+  Put<float>(file, camera_coord.x);
+  Put<float>(file, camera_coord.y);
+  Put<float>(file, camera_zoom);
+
+  Put<u32>(file, level.boards.size());
+  for (auto& board : level.boards) {
+    Put<u32>(file, board.width);
+    Put<u32>(file, board.height);
+    Put<u8>(file, board.has_clones);
+    // a void cell is a single 0, so dense boards need no positions. Chunked
+    // ones only write their tiles, each with its index in front
+    auto put_cell = [&](const optional<Cell>& cell) {
+      Put<u8>(file, cell ? cell->Pack() : 0);
+      if (cell) PutVarint(file, cell->number);
+    };
+    if (auto* dense = std::get_if<DenseCells>(&board.cells)) {
+      for (auto& cell : dense->cells) put_cell(cell);
+    } else {
+      auto& directory = std::get<ChunkedCells>(board.cells).directory;
+      Put<u32>(file, std::count_if(directory.begin(),
+                                   directory.end(),
+                                   [](auto& tile) { return (bool)tile; }));
+      for (u32 i = 0; i < directory.size(); i++) {
+        if (!directory[i]) continue;
+        Put<u32>(file, i);
+        for (auto& cell : *directory[i]) put_cell(cell);
+      }
+    }
+  }
+
+  Put<u32>(file, level.portals.size());
+  for (auto& portal : level.portals) {
+    Put<i32>(file, portal.x);
+    Put<i32>(file, portal.y);
+    Put<i32>(file, portal.width);
+    Put<i32>(file, portal.height);
+    Put<u32>(file, portal.from);
+    Put<u32>(file, portal.to);
+    Put<u8>(file, portal.clone);
+  }
+
+  file.flush();
+  file.close();
+  std::error_code error;
+  if (file) std::filesystem::rename(temp_path, snapshot_path, error);
+  if (!file || error) {
+    std::filesystem::remove(temp_path, error);
+    return false;
+  }
+
+  // a fresh journal belongs to this snapshot only
+  auto journal =
+      std::ofstream{journal_path, std::ios::binary | std::ios::trunc};
+  Put<u32>(journal, journal_magic);
+  Put<u64>(journal, level.seed);
+
+  saved_seed = level.seed;
+  level.journaled_moves = 0;
+  return true;
+}
+
+bool Snapshot::Read(Level& level) {
+  auto file = std::ifstream{snapshot_path, std::ios::binary};
+  if (!ReadHeader(file, level.name, level.seed)) return false;
+
+  level.rng.state = Take<u64>(file);
+  level.time = Take<float>(file);
+  level.mine_left = Take<i32>(file);
+  level.state = (State)Take<u8>(file);
+  level.started = Take<u8>(file);
+  level.root_board = Take<u32>(file);
+  auto camera = rl::Vector2{Take<float>(file), Take<float>(file)};
+  float zoom = Take<float>(file);
+
+  level.boards.clear();
+  level.boards.reserve(256);
+  u32 board_amount = Take<u32>(file);
+  for (u32 i = 0; i < board_amount && file; i++) {
+    u32 width = Take<u32>(file);
+    u32 height = Take<u32>(file);
+    if (width > max_board_side || height > max_board_side) return false;
+    auto& board = level.boards.emplace_back(width, height);
+    board.has_clones = Take<u8>(file);
+    // false on a corrupt cell
+    auto take_cell = [&](u32 x, u32 y) {
+      u8 bits = Take<u8>(file);
+      if (bits == 0) return true;
+      auto cell = Cell::Unpack(bits);
+      if (!cell) return false;
+      cell->number = TakeVarint(file);
+      board.Set(x, y, cell);
+      return true;
+    };
+    if (!board.Chunked()) {
+      for (u32 j = 0; j < width * height && file; j++) {
+        if (!take_cell(j % width, j / width)) return false;
+      }
+      continue;
+    }
+    auto& chunked = std::get<ChunkedCells>(board.cells);
+    u32 tile_amount = Take<u32>(file);
+    for (u32 j = 0; j < tile_amount && file; j++) {
+      u32 tile = Take<u32>(file);
+      if (tile >= chunked.directory.size()) return false;
+      u32 x0 = tile % chunked.tiles_x * ChunkedCells::tile_size;
+      u32 y0 = tile / chunked.tiles_x * ChunkedCells::tile_size;
+      u32 cells = ChunkedCells::tile_size * ChunkedCells::tile_size;
+      for (u32 k = 0; k < cells && file; k++) {
+        u32 x = x0 + ChunkedCells::Compact(k);
+        u32 y = y0 + ChunkedCells::Compact(k >> 1);
+        if (!take_cell(x, y)) return false;
+      }
+    }
+  }
+
+  level.portals.clear();
+  u32 portal_amount = Take<u32>(file);
+  for (u32 i = 0; i < portal_amount && file; i++) {
+    auto& portal = level.portals.emplace_back();
+    portal.x = Take<i32>(file);
+    portal.y = Take<i32>(file);
+    portal.width = Take<i32>(file);
+    portal.height = Take<i32>(file);
+    portal.from = Take<u32>(file);
+    portal.to = Take<u32>(file);
+    portal.clone = Take<u8>(file);
+  }
+
+  if (!file || level.boards.empty() || level.root_board >= board_amount)
+    return false;
+  for (auto& portal : level.portals) {
+    if (portal.from >= board_amount || portal.to >= board_amount) return false;
+  }
+
+  level.board_rect_cache.clear();
+  level.mouse_over = {};
+  level.mouse_over_last_frame = {};
+  level.requested_load = {};
+  level.moves.clear();
+  level.ResetNeighbors();
+
+  // replay whatever happened since the snapshot. A truncated last record
+  // (crash mid-write) is simply ignored
+  level.journaled_moves = 0;
+  auto journal = std::ifstream{journal_path, std::ios::binary};
+  if (Take<u32>(journal) == journal_magic &&
+      Take<u64>(journal) == level.seed) {
+    while (journal) {
+      auto type = (MoveType)Take<u8>(journal);
+      u32 board_index = Take<u32>(journal);
+      i32 x = Take<i32>(journal);
+      i32 y = Take<i32>(journal);
+      float time = Take<float>(journal);
+      if (!journal || board_index >= board_amount) break;
+
+      auto id = CellID{x, y, board_index};
+      if (!level.Get(id)) break;
+      level.time = time;
+      level.Apply({type, id});
+      level.journaled_moves++;
+    }
+  }
+  level.moves.clear();
+  level.winning_check_needed = true;
+
+  level.resume_camera = {camera, zoom};
+  return true;
+}
+
+bool Snapshot::Exists(std::string name) {
+  auto file = std::ifstream{snapshot_path, std::ios::binary};
+  std::string saved_name;
+  u64 seed;
+  return ReadHeader(file, saved_name, seed) && saved_name == name;
+}
+
+void Snapshot::Discard() {
+  std::remove(snapshot_path);
+  std::remove(journal_path);
+  saved_seed = 0;
+}
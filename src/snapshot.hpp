@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+
+class Level;
+// binary autosave of the game in progress. A full snapshot of the level's
+// mutable state is written once, after that every move only appends a few
+// bytes to the journal. Resuming never goes through levels.toml
+namespace Snapshot {
+// journals level.moves and clears them. Writes a full snapshot instead when
+// the autosave belongs to another game, the journal grew too long or an undo
+// made it useless
+void Save(Level& level);
+
+// full rewrite, also empties the journal. Written next to the old one and
+// renamed over it, false if that failed and the old one is still in place
+bool Write(Level& level);
+
+// rebuilds the saved level and replays the journal on top, safe to call from
+// the loading thread. false when there's nothing (valid) to resume
+bool Read(Level& level);
+
+// is the autosave an unfinished game of this level
+bool Exists(std::string name);
+
+void Discard();
+};  // namespace Snapshot
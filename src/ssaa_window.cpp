@@ -1,16 +1,34 @@
 #include "ssaa_window.hpp"
 
+#define GLFW_INCLUDE_NONE  // only for glfwPostEmptyEvent, no GL headers
+#include <external/glfw/include/GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 #include "imgui.h"
+#include "memory_report.hpp"
+#include "profiler.hpp"
 #include "rlImGui.h"
+#include "rlgl.h"
 
 rl::Vector2 canvas_size;
 float ssaa_scale;
+bool ssaa_auto = false;
+rl::Vector2 canvas_capacity;
 rl::Vector2 window_size;
 float inverse_aspect_ratio;
 bool resized;
 
+// auto mode range, below 1 is undersampling for weak integrated GPUs
+static constexpr float min_auto_scale = 0.75f;
+static constexpr float max_auto_scale = 2.0f;
+// seconds between two scale adjustments
+static constexpr double adapt_interval = 0.25;
+// a scale that missed the budget isn't tried again until this many seconds
+static constexpr double ceiling_duration = 10.0;
+
 SSAAWindow::SSAAWindow(u32 x, u32 y, float scale, std::string title) {
   window.Init(x, y, title);
   window.SetState(FLAG_VSYNC_HINT | FLAG_WINDOW_RESIZABLE);
@@ -18,68 +36,255 @@ SSAAWindow::SSAAWindow(u32 x, u32 y, float scale, std::string title) {
   SetTargetFPS(240);
 
   SetExitKey(KEY_NULL);
-  SetGlobals(x, y, scale);
+  SetView(x, y, scale);
   InitRenderTexture();
   this->scale = scale;
   target_scale = scale;
+  scale_ceiling = max_auto_scale;
 
   rlImGuiSetup(true);  // incorporate rlimgui state change into SSAAWindow, so
                        // no need to include rlimgui elsewhere
   ImGui::GetIO().IniFilename = NULL;
 }
 
+SSAAWindow::~SSAAWindow() {
+  if (!waker.joinable()) return;
+  {
+    std::lock_guard lock(wake_mutex);
+    closing = true;
+  }
+  wake_changed.notify_one();
+  waker.join();
+}
+
 void SSAAWindow::SetScale(float scale) {
+  view.ssaa_auto = false;
   target_scale = scale;
 }
 
+void SSAAWindow::CycleQuality() {
+  if (view.ssaa_auto)
+    SetScale(1.0f);
+  else if (scale == 1.0f)
+    SetScale(1.5f);
+  else if (scale == 1.5f)
+    SetScale(2.0f);
+  else {
+    view.ssaa_auto = true;
+    frame_time_avg = 0.0f;
+    scale_ceiling = max_auto_scale;
+  }
+}
+
 void SSAAWindow::CheckResize() {
+  AdaptScale();
   if (IsWindowResized() || target_scale != scale) {
-    resized = true;
+    view.resized = true;
     Resize();
   } else {
-    resized = false;
+    view.resized = false;
+  }
+}
+
+void SSAAWindow::AdaptScale() {
+  if (!view.ssaa_auto) return;
+  // idle frames (and the sleep before them) say nothing about render cost
+  if (!drawn_this_frame || !drawn_last_frame) return;
+
+  int refresh = GetMonitorRefreshRate(GetCurrentMonitor());
+  float budget = 1.0f / (refresh > 0 ? refresh : 60);
+
+  float frame_time = GetFrameTime();
+  if (frame_time_avg == 0.0f) frame_time_avg = frame_time;
+  frame_time_avg = frame_time_avg * 0.9f + frame_time * 0.1f;
+
+  double now = GetTime();
+  if (now - last_adapt < adapt_interval) return;
+  last_adapt = now;
+  if (now - ceiling_since > ceiling_duration) scale_ceiling = max_auto_scale;
+
+  float next = scale;
+  if (frame_time_avg > budget * 1.2f) {
+    // missing vsync, back off quickly and remember not to come back soon
+    scale_ceiling = scale;
+    ceiling_since = now;
+    next = scale * 0.85f;
+  } else if (frame_time_avg < budget * 1.05f) {
+    // with vsync there's no telling how much headroom is left, creep up until
+    // frames get missed
+    next = std::min(scale + 0.05f, scale_ceiling - 0.05f);
   }
+  next = std::clamp(next, min_auto_scale, max_auto_scale);
+  // steps of 1/32, no reason to resize for every tiny fluctuation
+  next = std::round(next * 32.0f) / 32.0f;
+  if (next != scale) target_scale = next;
+}
+
+// viewport and projection for just the canvas corner of a pooled target
+static void CanvasViewport(rl::Vector2 canvas_size) {
+  rlViewport(0, 0, canvas_size.x, canvas_size.y);
+  rlMatrixMode(RL_PROJECTION);
+  rlLoadIdentity();
+  rlOrtho(0, canvas_size.x, canvas_size.y, 0, 0.0f, 1.0f);
+  rlMatrixMode(RL_MODELVIEW);
+  rlLoadIdentity();
 }
 
 void SSAAWindow::BeginDrawing() {
   ssaa.BeginMode();
+  // only the corner the size of the canvas is used, BeginMode set everything
+  // up for the whole pooled target
+  CanvasViewport(view.canvas_size);
+
+  drawing = true;
+  drawn_this_frame = true;
 }
 
-void SSAAWindow::BeginImGui() {
-  ssaa.EndMode();
+void SSAAWindow::CaptureFeedback() {
+  PROFILE_ZONE("SSAA feedback");
+  if (feedback.texture.width != ssaa.texture.width ||
+      feedback.texture.height != ssaa.texture.height) {
+    feedback = rl::RenderTexture2D(ssaa.texture.width, ssaa.texture.height);
+    SetTextureFilter(feedback.texture, TEXTURE_FILTER_BILINEAR);
+    SetTextureWrap(feedback.texture, TEXTURE_WRAP_CLAMP);
+  }
+
+  if (drawing) ssaa.EndMode();
+  drawing = false;
+  feedback.BeginMode();
+  CanvasViewport(view.canvas_size);
+  // drawn the way it's presented, so the rows end up where they were
+  ((rl::Texture&)ssaa.texture)
+      .Draw(rl::Rectangle(0, 0, view.canvas_size.x, -view.canvas_size.y),
+            rl::Rectangle(0, 0, view.canvas_size.x, view.canvas_size.y));
+  feedback.EndMode();
+
+  feedback_size = view.canvas_size;
+  feedback_info = {feedback.texture, view.canvas_size.y};
+}
+
+const FeedbackTexture* SSAAWindow::Feedback() const {
+  if (feedback_size.x != view.canvas_size.x ||
+      feedback_size.y != view.canvas_size.y)
+    return nullptr;
+  return &feedback_info;
+}
+
+void SSAAWindow::BeginUI() {
+  PROFILE_ZONE("SSAA resolve");
+  if (drawing) ssaa.EndMode();
+  drawing = false;
   window.BeginDrawing();
+  // flipped, and only the canvas corner of the pooled target. Since GL's
+  // origin is bottom left that's the bottom canvas_size.y rows
   ((rl::Texture&)ssaa.texture)
-      .Draw(rl::Rectangle(0, 0, canvas_size.x, -canvas_size.y),
+      .Draw(rl::Rectangle(0, 0, view.canvas_size.x, -view.canvas_size.y),
             rl::Rectangle(0, 0, window.GetWidth(), window.GetHeight()));
-  // DrawTexturePro(ssaa.texture,
-  //                rl::Rectangle(0, 0, canvas_size.x, -canvas_size.y),
-  //                rl::Rectangle(0, 0, window.GetWidth(), window.GetHeight()),
-  //                rl::Vector2(0, 0),
-  //                0.0f,
-  //                Color{255, 255, 255, 255});
+  // flush here, otherwise the resolve is only paid for in EndDrawing
+  rlDrawRenderBatchActive();
+
+  // UI keeps using canvas pixel coordinates, but gets rasterized at native
+  // resolution instead of being supersampled
+  rlPushMatrix();
+  rlScalef(window.GetWidth() / view.canvas_size.x,
+           window.GetHeight() / view.canvas_size.y,
+           1.0f);
+}
+
+void SSAAWindow::BeginImGui() {
+  rlDrawRenderBatchActive();
+  rlPopMatrix();
   rlImGuiBegin();
 }
 
 void SSAAWindow::EndDrawing() {
   rlImGuiEnd();
   window.EndDrawing();
+  drawn_last_frame = drawn_this_frame;
+  drawn_this_frame = false;
+}
+
+void SSAAWindow::WaitForEvents(bool wait, double until) {
+  double now = GetTime();
+  if (!wait || (until != 0.0 && until <= now)) {
+    DisableEventWaiting();
+    return;
+  }
+  EnableEventWaiting();
+
+  std::optional<std::chrono::steady_clock::time_point> at;
+  if (until != 0.0) {
+    auto left = std::chrono::duration<double>(until - now);
+    at = std::chrono::steady_clock::now() +
+         std::chrono::duration_cast<std::chrono::steady_clock::duration>(left);
+  }
+  {
+    std::lock_guard lock(wake_mutex);
+    wake_at = at;
+  }
+  wake_changed.notify_one();
+  if (at && !waker.joinable()) waker = std::thread{&SSAAWindow::Wake, this};
+}
+
+void SSAAWindow::Wake() {
+  std::unique_lock lock(wake_mutex);
+  while (!closing) {
+    if (!wake_at) {
+      wake_changed.wait(lock);
+      continue;
+    }
+    auto at = wake_at.value();
+    wake_changed.wait_until(lock, at);
+    // moved or cleared in the meantime, go again with the new one
+    if (wake_at != at || std::chrono::steady_clock::now() < at) continue;
+    wake_at = {};
+    glfwPostEmptyEvent();  // thread safe, unlike the rest of glfw
+  }
+}
+
+void SSAAWindow::MeasureMemory(GPUMemory& gpu) const {
+  // the depth buffer raylib attaches is 24 bit, drivers pad that to 32
+  static constexpr u64 depth_bytes = 4;
+  u64 color_bytes = GetPixelDataSize(1, 1, ssaa.texture.format);
+  // the feedback target is the same size, once portal feedback needed it
+  u64 pixels = (u64)ssaa.texture.width * ssaa.texture.height +
+               (u64)feedback.texture.width * feedback.texture.height;
+  gpu.ssaa_bytes = pixels * (color_bytes + depth_bytes);
+  gpu.canvas_bytes = (u64)view.canvas_size.x * view.canvas_size.y *
+                     (color_bytes + depth_bytes);
+  gpu.ssaa_scale = view.ssaa_scale;
 }
 
 void SSAAWindow::Resize() {
-  SetGlobals(window.GetWidth(), window.GetHeight(), target_scale);
+  SetView(window.GetWidth(), window.GetHeight(), target_scale);
   InitRenderTexture();
   scale = target_scale;
 }
 
-void SSAAWindow::SetGlobals(u32 x, u32 y, float scale) {
-  window_size = rl::Vector2(x, y);
-  ssaa_scale = scale;
-  canvas_size = rl::Vector2((u32)(x * scale), (u32)(y * scale));
-  inverse_aspect_ratio = canvas_size.y / canvas_size.x;
+void SSAAWindow::SetView(u32 x, u32 y, float scale) {
+  view.window_size = rl::Vector2(x, y);
+  view.ssaa_scale = scale;
+  view.canvas_size = rl::Vector2((u32)(x * scale), (u32)(y * scale));
+  view.inverse_aspect_ratio = view.canvas_size.y / view.canvas_size.x;
 }
 
 void SSAAWindow::InitRenderTexture() {
-  ssaa = rl::RenderTexture2D(canvas_size.x, canvas_size.y);
+  if (view.canvas_size.x <= ssaa.texture.width &&
+      view.canvas_size.y <= ssaa.texture.height)
+    return;
+
+  // a quarter of headroom, rounded up, so dragging the window bigger only
+  // reallocates every now and then. Auto mode plans for its biggest scale
+  // right away
+  rl::Vector2 plan = view.canvas_size;
+  if (view.ssaa_auto) plan = view.window_size * max_auto_scale;
+  plan.x = std::max(plan.x, view.canvas_size.x) * 1.25f;
+  plan.y = std::max(plan.y, view.canvas_size.y) * 1.25f;
+  u32 width = std::min(((u32)plan.x + 255) / 256 * 256, (u32)16384);
+  u32 height = std::min(((u32)plan.y + 255) / 256 * 256, (u32)16384);
+
+  ssaa = rl::RenderTexture2D(width, height);
   SetTextureFilter(ssaa.texture, TEXTURE_FILTER_BILINEAR);
   SetTextureWrap(ssaa.texture, TEXTURE_WRAP_CLAMP);
+  view.canvas_capacity = rl::Vector2(width, height);
 }
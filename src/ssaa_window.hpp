@@ -1,10 +1,23 @@
 #pragma once
 
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <thread>
+
 #include "fixed_size_int.hpp"
+#include "draw_list.hpp"
+#include "input.hpp"
 #include "rl.hpp"
 
+struct GPUMemory;
+
+// the simulation's copy of the view, see Input::Begin
 extern rl::Vector2 canvas_size;
 extern float ssaa_scale;
+extern bool ssaa_auto;  // scale follows frame time instead of the UI buttons
+extern rl::Vector2 canvas_capacity;  // size of the pooled render target
 extern rl::Vector2 window_size;
 extern float inverse_aspect_ratio;
 extern bool resized;
@@ -12,32 +25,84 @@ extern bool resized;
 class SSAAWindow {
  public:
   SSAAWindow(u32 x, u32 y, float scale, std::string title);
+  ~SSAAWindow();
 
-  // Superresolution Scale, only actually changes at BeginDrawing
+  // Superresolution Scale, only actually changes at BeginDrawing. Leaves auto
+  // mode
   void SetScale(float scale);
 
+  // what the quality button does: low -> mid -> high -> auto -> low
+  void CycleQuality();
+
   // call this at the start of a loop, only does lazy updating
   void CheckResize();
 
-  // this one second
+  // this one second, skip it (and the drawing) to show last frame's canvas
+  // again
   void BeginDrawing();
 
-  // third
+  // optional, between the second and third. Copies the canvas for next frame's
+  // portal feedback
+  void CaptureFeedback();
+  // the last captured canvas, null when there's none of the current size
+  const FeedbackTexture* Feedback() const;
+
+  // third, presents the canvas. Anything drawn after this is at native
+  // resolution but still in canvas pixel coordinates, for the UI
+  void BeginUI();
+
+  // fourth
   void BeginImGui();
 
   // lastly this
   void EndDrawing();
 
+  // EndDrawing sleeps until input arrives, or until GetTime() reaches until
+  // when it's not 0. Never waits for an until that already passed
+  void WaitForEvents(bool wait, double until = 0.0);
+
   inline bool ShouldClose() { return window.ShouldClose(); };
+  // what the window looks like right now, for Input::Capture
+  inline const View& GetView() const { return view; };
+  // the pooled target's framebuffer, the canvas is its bottom left
+  // GetView().canvas_size corner with rows bottom up. For Readback
+  inline u32 CanvasFramebuffer() const { return ssaa.id; };
+  // fills in the render target's part
+  void MeasureMemory(GPUMemory& gpu) const;
 
   float scale;
 
  private:
-  void InitRenderTexture();  // Requires canvas_size to be set
+  // Requires view.canvas_size to be set. Only reallocates when the canvas
+  // outgrows the pooled target, smaller canvases render into a corner of it
+  void InitRenderTexture();
   void Resize();
-  void SetGlobals(u32 x, u32 y, float scale);
+  void SetView(u32 x, u32 y, float scale);
+  // auto mode, nudges target_scale toward the frame time budget
+  void AdaptScale();
 
   rl::Window window;
+  View view = {};
   rl::RenderTexture2D ssaa;
+  rl::RenderTexture2D feedback;  // allocated on first capture
+  FeedbackTexture feedback_info;
+  rl::Vector2 feedback_size = {0, 0};  // canvas size when captured
   float target_scale;
+  bool drawing = false;  // between BeginDrawing and BeginUI
+  bool drawn_this_frame = false;
+  bool drawn_last_frame = false;
+
+  float frame_time_avg = 0.0f;
+  double last_adapt = 0.0;
+  float scale_ceiling;  // last scale that missed the budget, for a while
+  double ceiling_since = 0.0;
+
+  // raylib's event wait has no timeout, this thread posts an empty event at
+  // wake_at instead. Started by the first timed wait
+  void Wake();
+  std::thread waker;
+  std::mutex wake_mutex;
+  std::condition_variable wake_changed;
+  std::optional<std::chrono::steady_clock::time_point> wake_at;
+  bool closing = false;
 };
@@ -0,0 +1,60 @@
+#include "startup.hpp"
+
+#include <imgui.h>
+
+#include <algorithm>
+
+#include "rl.hpp"
+
+StartupTimeline::StartupTimeline()
+    : launch(std::chrono::steady_clock::now()),
+      main_thread(std::this_thread::get_id()) {}
+
+double StartupTimeline::Now() const {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - launch)
+      .count();
+}
+
+StartupTimeline::Phase::Phase(StartupTimeline& timeline, std::string name)
+    : timeline(timeline),
+      name(std::move(name)),
+      main_thread(std::this_thread::get_id() == timeline.main_thread),
+      begin_ms(timeline.Now()) {}
+
+StartupTimeline::Phase::~Phase() {
+  double end_ms = timeline.Now();
+  std::lock_guard lock(timeline.mutex);
+  timeline.entries.push_back({name, main_thread, begin_ms, end_ms});
+}
+
+StartupTimeline::Phase StartupTimeline::Begin(std::string name) {
+  return Phase{*this, std::move(name)};
+}
+
+void StartupTimeline::Report() {
+  std::lock_guard lock(mutex);
+  std::sort(entries.begin(), entries.end(), [](auto& a, auto& b) {
+    return a.begin_ms < b.begin_ms;
+  });
+  for (auto& entry : entries) {
+    TraceLog(LOG_INFO,
+             "STARTUP: %-22s %7.1f to %7.1f ms, %6.1f ms on %s",
+             entry.name.c_str(),
+             entry.begin_ms,
+             entry.end_ms,
+             entry.end_ms - entry.begin_ms,
+             entry.main_thread ? "main" : "a worker");
+  }
+}
+
+void StartupTimeline::DrawImGui() const {
+  std::lock_guard lock(mutex);
+  for (auto& entry : entries) {
+    ImGui::Text("%s%s: %.1f ms, at %.1f ms",
+                entry.main_thread ? "" : "(worker) ",
+                entry.name.c_str(),
+                entry.end_ms - entry.begin_ms,
+                entry.begin_ms);
+  }
+}
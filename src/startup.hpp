@@ -0,0 +1,53 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fixed_size_int.hpp"
+
+// when each part of startup ran and on which thread, counted from launch.
+// Decoding and parsing run on workers while the window and GL context come
+// up, this shows how much of that actually overlaps
+class StartupTimeline {
+ public:
+  StartupTimeline();  // launch is now
+
+  // lasts until it goes out of scope
+  class Phase {
+   public:
+    Phase(StartupTimeline& timeline, std::string name);
+    Phase(const Phase&) = delete;  // a copy would end it twice
+    ~Phase();
+
+   private:
+    StartupTimeline& timeline;
+    std::string name;
+    bool main_thread;
+    double begin_ms;
+  };
+
+  // any thread
+  Phase Begin(std::string name);
+
+  // logs every phase, call once startup is over
+  void Report();
+  // call inside an ImGui window
+  void DrawImGui() const;
+
+ private:
+  struct Entry {
+    std::string name;
+    bool main_thread;
+    double begin_ms;
+    double end_ms;
+  };
+  double Now() const;
+
+  std::chrono::steady_clock::time_point launch;
+  std::thread::id main_thread;
+  mutable std::mutex mutex;
+  std::vector<Entry> entries;  // in the order they ended
+};
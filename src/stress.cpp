@@ -0,0 +1,115 @@
+#include "stress.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+std::string Stress::Generate(const StressParams& params,
+                             std::string_view name) {
+  u32 boards = std::max(params.boards, 1u);
+  u32 depth = std::clamp(params.depth, 1u, boards);
+  u32 size = std::max(params.size, 2u);
+  float density = std::clamp(params.density, 0.0f, 1.0f);
+
+  // layer l is boards first[l] up to first[l + 1], none of them empty
+  std::vector<u32> first(depth + 1);
+  for (u32 l = 0; l <= depth; l++) first[l] = l * boards / depth;
+
+  struct Hole {
+    u32 to;
+    bool clone;
+  };
+  std::vector<Hole> holes;
+  std::vector<bool> hollow(size * size);
+
+  std::string text;
+  text.reserve(boards * (size * (size * 2 + 1) + 128) + 64);
+  text += "[";
+  text += name;
+  text += "]\n";
+  std::string portals = "portals = [\n";
+
+  u32 layer = 0;
+  for (u32 i = 0; i < boards; i++) {
+    while (i >= first[layer + 1]) layer++;
+    u32 next = (layer + 1) % depth;
+    u32 next_size = first[next + 1] - first[next];
+
+    // round robin over the next layer keeps every board about as often held
+    holes.clear();
+    u32 clones = std::min(params.clones, params.fanout);
+    for (u32 p = 0; p < params.fanout; p++) {
+      u32 to = first[next] + (i * params.fanout + p) % next_size;
+      holes.push_back({to, p >= params.fanout - clones});
+    }
+    if (i < params.cycles) holes.push_back({i, false});
+
+    // a grid of slots, the hole takes half a slot so cells surround it
+    u32 per_row = std::ceil(std::sqrt((float)holes.size()));
+    per_row = std::clamp(per_row, 1u, size / 2);
+    holes.resize(std::min<size_t>(holes.size(), per_row * per_row));
+    u32 slot = size / per_row;
+    u32 hole = slot / 2;
+
+    std::fill(hollow.begin(), hollow.end(), false);
+    for (u32 h = 0; h < holes.size(); h++) {
+      u32 x = h % per_row * slot + (slot - hole) / 2;
+      u32 y = h / per_row * slot + (slot - hole) / 2;
+      for (u32 dy = 0; dy < hole; dy++) {
+        for (u32 dx = 0; dx < hole; dx++)
+          hollow[(y + dy) * size + x + dx] = true;
+      }
+      portals += "    { from = " + std::to_string(i) +
+                 ", to = " + std::to_string(holes[h].to) +
+                 ", x = " + std::to_string(x) + ", y = " + std::to_string(y) +
+                 ", w = " + std::to_string(hole) +
+                 ", h = " + std::to_string(hole);
+      portals += holes[h].clone ? ", clone = true },\n" : " },\n";
+    }
+
+    u32 cells = 0;
+    text += "board" + std::to_string(i) + " = \"\"\"\n";
+    for (u32 y = 0; y < size; y++) {
+      for (u32 x = 0; x < size; x++) {
+        bool is_hollow = hollow[y * size + x];
+        text += is_hollow ? ".." : "[]";
+        if (!is_hollow) cells++;
+      }
+      text += "\n";
+    }
+    text += "\"\"\"\n";
+    text += "board" + std::to_string(i) +
+            "mine = " + std::to_string((u32)(cells * density)) + "\n";
+  }
+  text += portals;
+  text += "]\n";
+  return text;
+}
+
+bool Stress::Set(StressParams& params, std::string_view assignment) {
+  auto equals = assignment.find('=');
+  if (equals == std::string_view::npos) return false;
+  auto key = assignment.substr(0, equals);
+  auto value = assignment.substr(equals + 1);
+
+  if (key == "density") {
+    auto copy = std::string{value};
+    char* end;
+    params.density = std::strtof(copy.c_str(), &end);
+    return !copy.empty() && *end == '\0';
+  }
+
+  u32* field = nullptr;
+  if (key == "boards") field = &params.boards;
+  if (key == "size") field = &params.size;
+  if (key == "fanout") field = &params.fanout;
+  if (key == "depth") field = &params.depth;
+  if (key == "clones") field = &params.clones;
+  if (key == "cycles") field = &params.cycles;
+  if (!field) return false;
+  auto end = value.data() + value.size();
+  auto result = std::from_chars(value.data(), end, *field);
+  return result.ec == std::errc{} && result.ptr == end;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "fixed_size_int.hpp"
+
+// synthetic levels in levels.toml's format, big or tangled enough to show how
+// loading, neighbors and drawing scale. Boards are split into `depth` layers,
+// every board has `fanout` portals into the next layer and the last layer
+// holds the first, so it recurses forever like the real levels
+struct StressParams {
+  u32 boards = 16;
+  u32 size = 16;    // width and height of every board
+  u32 fanout = 2;   // portals out of each board
+  u32 depth = 4;    // layers of boards
+  u32 clones = 0;   // how many of a board's portals are clones
+  u32 cycles = 0;   // boards that hold themselves too
+  float density = 0.15f;
+};
+
+namespace Stress {
+// one table named `name`, ready to append to levels.toml or a pack. Portals
+// that don't fit in a board are left out
+std::string Generate(const StressParams& params, std::string_view name);
+
+// "boards=64", false for an unknown key or a bad value
+bool Set(StressParams& params, std::string_view assignment);
+};  // namespace Stress
@@ -2,8 +2,9 @@
 
 #include <algorithm>
 
-#include "ssaa_window.hpp"
+#include "input.hpp"
 #include "scene.hpp"
+#include "ssaa_window.hpp"
 
 rl::Vector2 camera_coord = rl::Vector2(0, 0);
 float camera_zoom = 0.1f;
@@ -13,6 +14,12 @@ bool camera_moved = false;
 const float zoom_max = 256.0f;
 const float zoom_min = 0.005f;
 
+// the frame after the loop slept waiting for input can be seconds long, which
+// would fling the camera away
+static float FrameTime() {
+  return std::min(Input::GetFrameTime(), 0.05f);
+}
+
 namespace CoordTransform {
 
 void UpdateCamera() {
@@ -32,13 +39,16 @@ void UpdateCameraKeyboard() {
   const float camera_zoom_speed = 0.4f;
   const float elasticity = 0.75f;
 
-  float mul_this_frame = 1 - (1 - elasticity) * GetFrameTime() * 60.0f;
-  float delta = GetFrameTime() * GetFrameTime() * 60.0f;
+  float mul_this_frame = 1 - (1 - elasticity) * FrameTime() * 60.0f;
+  float delta = FrameTime() * FrameTime() * 60.0f;
 
-  if (IsKeyDown(KEY_W) || IsKeyDown(KEY_UP)) cam_move.y -= delta;
-  if (IsKeyDown(KEY_A) || IsKeyDown(KEY_LEFT)) cam_move.x -= delta;
-  if (IsKeyDown(KEY_S) || IsKeyDown(KEY_DOWN)) cam_move.y += delta;
-  if (IsKeyDown(KEY_D) || IsKeyDown(KEY_RIGHT)) cam_move.x += delta;
+  auto down = [](int key, int alternative) {
+    return Input::IsKeyDown(key) || Input::IsKeyDown(alternative);
+  };
+  if (down(KEY_W, KEY_UP)) cam_move.y -= delta;
+  if (down(KEY_A, KEY_LEFT)) cam_move.x -= delta;
+  if (down(KEY_S, KEY_DOWN)) cam_move.y += delta;
+  if (down(KEY_D, KEY_RIGHT)) cam_move.x += delta;
   camera_coord += cam_move / camera_zoom * camera_move_speed;
   cam_move *= mul_this_frame;
 
@@ -46,20 +56,22 @@ void UpdateCameraKeyboard() {
 
   // yes I know they are mouse buttons, but putting this here would make things
   // simpler
-  if (IsKeyDown(KEY_LEFT_SHIFT) || IsMouseButtonDown(MOUSE_BUTTON_EXTRA))
+  if (Input::IsKeyDown(KEY_LEFT_SHIFT) ||
+      Input::IsMouseButtonDown(MOUSE_BUTTON_EXTRA))
     cam_zoom_delta -= delta;
-  if (IsKeyDown(KEY_LEFT_CONTROL) || IsMouseButtonDown(MOUSE_BUTTON_SIDE))
+  if (Input::IsKeyDown(KEY_LEFT_CONTROL) ||
+      Input::IsMouseButtonDown(MOUSE_BUTTON_SIDE))
     cam_zoom_delta += delta;
   camera_zoom /= 1.0f + cam_zoom_delta * camera_zoom_speed;
   cam_zoom_delta *= mul_this_frame;
 }
 
 void UpdateCameraMouse() {
-  if (IsMouseButtonDown(MOUSE_BUTTON_LEFT) ||
-      IsMouseButtonDown(MOUSE_BUTTON_MIDDLE) ||
-      IsMouseButtonDown(MOUSE_BUTTON_RIGHT)) {
+  if (Input::IsMouseButtonDown(MOUSE_BUTTON_LEFT) ||
+      Input::IsMouseButtonDown(MOUSE_BUTTON_MIDDLE) ||
+      Input::IsMouseButtonDown(MOUSE_BUTTON_RIGHT)) {
     rl::Vector2 mouse_global_delta =
-        (rl::Vector2)GetMouseDelta() / window_size.x / camera_zoom;
+        (rl::Vector2)Input::GetMouseDelta() / window_size.x / camera_zoom;
     camera_coord -= mouse_global_delta;
   }
 
@@ -67,7 +79,7 @@ void UpdateCameraMouse() {
   // time for a buffer
   const float wheel_zoom_speed = 125.0f;
   const float wheel_elasticity = 0.85f;
-  float mul_this_frame = 1 - (1 - wheel_elasticity) * GetFrameTime() * 60.0f;
+  float mul_this_frame = 1 - (1 - wheel_elasticity) * FrameTime() * 60.0f;
 
   //0.85^96 ~= 0.00000017, good enough to hold all data
   const int buf_size = 96;
@@ -77,7 +89,7 @@ void UpdateCameraMouse() {
   }
 
   // positive is zoom in
-  zoom[buf_size - 1] = GetMouseWheelMove();
+  zoom[buf_size - 1] = Input::GetMouseWheelMove();
   float zoom_avg = 0;
   for (int i = 0; i < buf_size; i++) {
     zoom_avg += zoom[i];
@@ -88,9 +100,9 @@ void UpdateCameraMouse() {
   if (zoom_avg < 0 && camera_zoom <= zoom_min) return;
   if (zoom_avg > 0 && camera_zoom >= zoom_max) return;
 
-  float factor = 1.0f + zoom_avg * GetFrameTime() * wheel_zoom_speed;
+  float factor = 1.0f + zoom_avg * FrameTime() * wheel_zoom_speed;
   rl::Vector2 mouse_pos = CoordTransform::PixelToWorld(
-      (rl::Vector2)GetMousePosition() * ssaa_scale);
+      (rl::Vector2)Input::GetMousePosition() * ssaa_scale);
 
   camera_coord = mouse_pos - (mouse_pos - camera_coord) / factor;
   camera_zoom *= factor;
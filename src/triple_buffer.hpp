@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+
+#include "fixed_size_int.hpp"
+
+// one producer hands whole values to one consumer without either ever
+// waiting. The producer fills its back slot and swaps it with the middle one,
+// the consumer swaps the middle one with its front slot when it's newer. Slots
+// are reused, so vectors inside keep their capacity
+template <typename T>
+class TripleBuffer {
+ public:
+  // producer only
+  inline T& Back() { return slots[back]; };
+  inline void Publish() {
+    back = middle.exchange(back | fresh, std::memory_order_acq_rel) & index;
+  };
+
+  // consumer only, true when a newer value became the front one
+  inline bool Update() {
+    if (!(middle.load(std::memory_order_relaxed) & fresh)) return false;
+    front = middle.exchange(front, std::memory_order_acq_rel) & index;
+    return true;
+  };
+  inline const T& Front() const { return slots[front]; };
+
+  // the producer may read any slot but its own while the consumer does too,
+  // neither writes it
+  inline const T& Slot(u8 i) const { return slots[i]; };
+  inline u8 BackIndex() const { return back; };
+
+ private:
+  static constexpr u8 index = 0b011;
+  static constexpr u8 fresh = 0b100;
+
+  T slots[3];
+  u8 back = 0;
+  u8 front = 1;
+  std::atomic<u8> middle = 2;
+};
@@ -0,0 +1,232 @@
+// builds res/assets.pack from the pngs in res/, see AssetPack. Run by the
+// `assets` target, or by hand: asset_packer <res folder> <output> [--bc]
+//
+// mips are made on the CPU with raylib and stored as raw RGBA8, exactly what
+// the pngs decode to. --bc block compresses every level instead: BC1 (DXT1)
+// for opaque textures, BC3 (DXT5) for ones with alpha. 4 to 8 times smaller,
+// but lossy, which shows on the sprites' hard edges
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "asset_pack.hpp"
+
+// name and sprites per row, the same as AtlasManager's x_max
+struct Source {
+  const char* name;
+  u32 columns;
+};
+static const Source sources[] = {
+    {"tile", 4},
+    {"number_0", 4},
+    {"number_1", 4},
+    {"ui", 8},
+    {"logo", 1},
+    {"loading", 1},
+};
+
+struct Color8 {
+  u8 r, g, b, a;
+};
+
+static u16 To565(const Color8& c) {
+  return (c.r >> 3) << 11 | (c.g >> 2) << 5 | c.b >> 3;
+}
+
+static Color8 From565(u16 c) {
+  u8 r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+  return {(u8)(r << 3 | r >> 2),
+          (u8)(g << 2 | g >> 4),
+          (u8)(b << 3 | b >> 2),
+          255};
+}
+
+static u32 Distance(const Color8& a, const Color8& b) {
+  int r = a.r - b.r, g = a.g - b.g, bl = a.b - b.b;
+  return r * r + g * g + bl * bl;
+}
+
+// bounding box of the block's colors, inset a little so outliers don't waste
+// the range, always in four color mode
+static void EncodeColor(const Color8 (&block)[16], u8* out) {
+  Color8 low = {255, 255, 255, 255}, high = {0, 0, 0, 0};
+  for (auto& c : block) {
+    low = {std::min(low.r, c.r),
+           std::min(low.g, c.g),
+           std::min(low.b, c.b),
+           255};
+    high = {std::max(high.r, c.r),
+            std::max(high.g, c.g),
+            std::max(high.b, c.b),
+            255};
+  }
+  auto inset = [](u8& lo, u8& hi) {
+    int pad = (hi - lo) / 16;
+    lo += pad;
+    hi -= pad;
+  };
+  inset(low.r, high.r);
+  inset(low.g, high.g);
+  inset(low.b, high.b);
+
+  u16 c0 = To565(high), c1 = To565(low);
+  if (c0 < c1) std::swap(c0, c1);
+  Color8 palette[4] = {From565(c0), From565(c1)};
+  auto mix = [](const Color8& a, const Color8& b) {
+    return Color8{(u8)((2 * a.r + b.r) / 3),
+                  (u8)((2 * a.g + b.g) / 3),
+                  (u8)((2 * a.b + b.b) / 3),
+                  255};
+  };
+  palette[2] = mix(palette[0], palette[1]);
+  palette[3] = mix(palette[1], palette[0]);
+
+  u32 indices = 0;
+  if (c0 != c1) {
+    for (int i = 0; i < 16; i++) {
+      u32 best = 0;
+      for (u32 p = 1; p < 4; p++) {
+        if (Distance(block[i], palette[p]) < Distance(block[i], palette[best]))
+          best = p;
+      }
+      indices |= best << (i * 2);
+    }
+  }
+  memcpy(out, &c0, 2);
+  memcpy(out + 2, &c1, 2);
+  memcpy(out + 4, &indices, 4);
+}
+
+// eight interpolated alphas between the block's lowest and highest
+static void EncodeAlpha(const Color8 (&block)[16], u8* out) {
+  u8 low = 255, high = 0;
+  for (auto& c : block) {
+    low = std::min(low, c.a);
+    high = std::max(high, c.a);
+  }
+  out[0] = high;
+  out[1] = low;
+
+  u64 indices = 0;
+  if (high != low) {
+    for (int i = 0; i < 16; i++) {
+      // 0 is high, 1 is low, 2 to 7 go from high to low
+      int step = ((high - block[i].a) * 7 + (high - low) / 2) / (high - low);
+      u64 index = step == 0 ? 0 : step == 7 ? 1 : step + 1;
+      indices |= index << (i * 3);
+    }
+  }
+  memcpy(out + 2, &indices, 6);
+}
+
+// whole mip level, width and height multiples of 4
+static void Compress(const u8* rgba,
+                     u32 width,
+                     u32 height,
+                     bool alpha,
+                     std::vector<u8>& out) {
+  Color8 block[16];
+  for (u32 by = 0; by < height; by += 4) {
+    for (u32 bx = 0; bx < width; bx += 4) {
+      for (u32 i = 0; i < 16; i++) {
+        auto* p = rgba + ((by + i / 4) * width + bx + i % 4) * 4;
+        block[i] = {p[0], p[1], p[2], p[3]};
+      }
+      size_t at = out.size();
+      out.resize(at + (alpha ? 16 : 8));
+      if (alpha) EncodeAlpha(block, &out[at]);
+      EncodeColor(block, &out[at + (alpha ? 8 : 0)]);
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: asset_packer <res folder> <output> [--bc]\n");
+    return 1;
+  }
+  std::string folder = argv[1];
+  bool raw = !(argc > 3 && std::string{argv[3]} == "--bc");
+  SetTraceLogLevel(LOG_WARNING);
+
+  std::vector<AssetPack::Record> records;
+  std::vector<u8> data;
+  for (auto& source : sources) {
+    auto path = folder + "/" + source.name + ".png";
+    Image image = LoadImage(path.c_str());
+    if (!image.data) {
+      fprintf(stderr, "can't load %s\n", path.c_str());
+      return 1;
+    }
+    ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    ImageMipmaps(&image);
+
+    bool alpha = false;
+    auto* pixels = (const u8*)image.data;
+    for (int i = 0; i < image.width * image.height && !alpha; i++)
+      alpha = pixels[i * 4 + 3] != 255;
+
+    AssetPack::Record record = {};
+    strncpy(record.name, source.name, sizeof(record.name) - 1);
+    record.width = image.width;
+    record.height = image.height;
+    record.columns = source.columns;
+    record.offset = data.size();
+
+    if (raw) {
+      record.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+      record.mipmaps = image.mipmaps;
+      u64 bytes = 0;
+      for (int i = 0; i < image.mipmaps; i++) {
+        bytes += GetPixelDataSize(std::max(image.width >> i, 1),
+                                  std::max(image.height >> i, 1),
+                                  record.format);
+      }
+      data.insert(data.end(), pixels, pixels + bytes);
+    } else {
+      record.format = alpha ? PIXELFORMAT_COMPRESSED_DXT5_RGBA
+                            : PIXELFORMAT_COMPRESSED_DXT1_RGB;
+      // levels whose sides aren't multiples of 4 don't fit in blocks,
+      // raylib would size them wrong too. The game caps the chain there
+      auto* level = pixels;
+      for (int i = 0; i < image.mipmaps; i++) {
+        u32 width = std::max(image.width >> i, 1);
+        u32 height = std::max(image.height >> i, 1);
+        if (width % 4 || height % 4) break;
+        Compress(level, width, height, alpha, data);
+        level += width * height * 4;
+        record.mipmaps++;
+      }
+    }
+    record.bytes = data.size() - record.offset;
+    records.push_back(record);
+    printf("%s: %dx%d, %u mips, %s, %.1f MB\n",
+           source.name,
+           image.width,
+           image.height,
+           record.mipmaps,
+           raw ? "rgba" : alpha ? "bc3" : "bc1",
+           record.bytes / 1048576.0);
+    UnloadImage(image);
+  }
+
+  // offsets so far are into data, which goes after the records
+  u64 start = sizeof(AssetPack::Header) + records.size() * sizeof(records[0]);
+  for (auto& record : records) record.offset += start;
+
+  FILE* file = fopen(argv[2], "wb");
+  if (!file) {
+    fprintf(stderr, "can't write %s\n", argv[2]);
+    return 1;
+  }
+  AssetPack::Header header = {
+      AssetPack::magic, AssetPack::version, (u32)records.size(), 0};
+  fwrite(&header, sizeof(header), 1, file);
+  fwrite(records.data(), sizeof(records[0]), records.size(), file);
+  fwrite(data.data(), 1, data.size(), file);
+  fclose(file);
+  return 0;
+}